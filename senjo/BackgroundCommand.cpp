@@ -21,12 +21,115 @@
 //-----------------------------------------------------------------------------
 
 #include "BackgroundCommand.h"
+#include "EpdFile.h"
+#include "Histogram.h"
+#include "LineFormatter.h"
 #include "MoveFinder.h"
 #include "Output.h"
+#include "ReferenceBoard.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include <fstream>
+#include <map>
+#include <vector>
 
 namespace senjo {
 
+//-----------------------------------------------------------------------------
+//! \brief Join the given values together into a single string
+//-----------------------------------------------------------------------------
+template<typename... Args>
+static std::string join(const Args&... args) {
+  std::stringstream ss;
+  int expand[] = { 0, ((ss << args), 0)... };
+  (void)expand;
+  return ss.str();
+}
+
+//-----------------------------------------------------------------------------
+//! \brief Mean of paired differences with a 95% confidence interval
+//-----------------------------------------------------------------------------
+struct PairedDiff {
+  double meanA;
+  double meanB;
+  double diff;   //!< mean of (B - A)
+  double margin; //!< half width of the 95% confidence interval around diff
+
+  bool significant() const { return (fabs(diff) > margin); }
+};
+
+//-----------------------------------------------------------------------------
+//! \brief Two-sided 95% critical value of Student's t distribution
+//! \param[in] df Degrees of freedom
+//-----------------------------------------------------------------------------
+static double tCritical95(const size_t df) {
+  static const double table[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+  };
+  if (df < 1) {
+    return 0;
+  }
+  if (df <= 30) {
+    return table[df - 1];
+  }
+  return (df <= 40) ? 2.021 : (df <= 60) ? 2.000 : (df <= 120) ? 1.980 : 1.960;
+}
+
+//-----------------------------------------------------------------------------
+//! \brief Compare two sets of measurements taken on the same positions
+//! \param[in] a Measurements under configuration A
+//! \param[in] b Measurements under configuration B, same order as \p a
+//-----------------------------------------------------------------------------
+static PairedDiff pairedDiff(const std::vector<double>& a,
+                             const std::vector<double>& b)
+{
+  PairedDiff result = { 0, 0, 0, 0 };
+  const size_t n = std::min(a.size(), b.size());
+  if (!n) {
+    return result;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    result.meanA += a[i];
+    result.meanB += b[i];
+  }
+  result.meanA /= n;
+  result.meanB /= n;
+  result.diff = (result.meanB - result.meanA);
+  if (n > 1) {
+    double variance = 0;
+    for (size_t i = 0; i < n; ++i) {
+      const double delta = ((b[i] - a[i]) - result.diff);
+      variance += (delta * delta);
+    }
+    variance /= (n - 1);
+    result.margin = (tCritical95(n - 1) * sqrt(variance / n));
+  }
+  return result;
+}
+
+//-----------------------------------------------------------------------------
+//! \brief Format a paired difference for the compare summary
+//-----------------------------------------------------------------------------
+static std::string format(const PairedDiff& pd, const int precision = 0) {
+  std::stringstream ss;
+  ss.setf(std::ios::fixed);
+  ss.precision(precision);
+  ss << "A " << pd.meanA << ", B " << pd.meanB << ", B-A "
+     << std::showpos << pd.diff << std::noshowpos << " +/- " << pd.margin;
+  if (pd.meanA != 0) {
+    ss.precision(1);
+    ss << " (" << std::showpos << (100 * pd.diff / pd.meanA) << std::noshowpos
+       << "%)";
+  }
+  if (pd.significant()) {
+    ss << " *";
+  }
+  return ss.str();
+}
+
 //-----------------------------------------------------------------------------
 bool BackgroundCommand::parseAndExecute(Parameters& params) {
   if (!parse(params)) {
@@ -83,6 +186,36 @@ void RegisterCommandHandle::doWork() {
   }
 }
 
+//-----------------------------------------------------------------------------
+bool CustomCommandHandle::parse(Parameters& commandParams) {
+  params = commandParams;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void CustomCommandHandle::doWork() {
+  handler(params);
+}
+
+//-----------------------------------------------------------------------------
+//! \brief Pop a "go" time parameter and its value in milliseconds
+//! GUIs may send a negative remaining time after lag, that is treated as 0.
+//! \param[in] params The "go" command parameters
+//! \param[in] paramName The name of the time parameter, e.g. "wtime"
+//! \param[out] msecs Set to the value, 0 if it's negative
+//! \return true if the parameter and its value were popped
+//-----------------------------------------------------------------------------
+static bool popMsecs(Parameters& params, const std::string& paramName,
+                     uint64_t& msecs)
+{
+  int64_t value = 0;
+  if (!params.popNumber(paramName, value)) {
+    return false;
+  }
+  msecs = static_cast<uint64_t>(std::max<int64_t>(value, 0));
+  return true;
+}
+
 //-----------------------------------------------------------------------------
 bool GoCommandHandle::parse(Parameters& params) {
   goParams = GoParams(); // reset all params to default values
@@ -97,12 +230,12 @@ bool GoCommandHandle::parse(Parameters& params) {
         params.popParam("ponder", goParams.ponder) ||
         params.popNumber("depth", goParams.depth) ||
         params.popNumber("movestogo", goParams.movestogo) ||
-        params.popNumber("binc", goParams.binc) ||
-        params.popNumber("btime", goParams.btime) ||
-        params.popNumber("movetime",  goParams.movetime) ||
+        popMsecs(params, "binc", goParams.binc) ||
+        popMsecs(params, "btime", goParams.btime) ||
+        popMsecs(params, "movetime",  goParams.movetime) ||
         params.popNumber("nodes", goParams.nodes) ||
-        params.popNumber("winc", goParams.winc) ||
-        params.popNumber("wtime", goParams.wtime))
+        popMsecs(params, "winc", goParams.winc) ||
+        popMsecs(params, "wtime", goParams.wtime))
     {
       continue;
     }
@@ -120,6 +253,13 @@ bool GoCommandHandle::parse(Parameters& params) {
 
 //-----------------------------------------------------------------------------
 void GoCommandHandle::doWork() {
+  if (stopTime.load() != TimePoint()) {
+    // stop arrived before the search started, engines typically clear their
+    // stop flag when go() begins so do the minimum search that gives a move
+    goParams = GoParams();
+    goParams.depth = 1;
+  }
+
   std::string ponderMove;
   std::string bestMove = engine.go(goParams, &ponderMove);
 
@@ -128,12 +268,22 @@ void GoCommandHandle::doWork() {
     ponderMove.clear();
   }
 
+  LineFormatter line;
+  line << "bestmove " << bestMove;
   if (ponderMove.size()) {
-    Output(Output::NoPrefix) << "bestmove " << bestMove
-                             << " ponder " << ponderMove;
+    line << " ponder " << ponderMove;
   }
-  else {
-    Output(Output::NoPrefix) << "bestmove " << bestMove;
+  Output::write(line.view(), Output::NoPrefix);
+
+  const TimePoint stopped = stopTime;
+  if (stopped != TimePoint()) {
+    const uint64_t usecs = getUsecs(stopped);
+    if (latency) {
+      latency->add(usecs);
+    }
+    if (engine.isDebugOn()) {
+      Output() << "stop to bestmove " << usecs << " usecs";
+    }
   }
 }
 
@@ -142,21 +292,84 @@ const std::string PerftCommandHandle::_TEST_FILE = "epd/perftsuite.epd";
 
 //-----------------------------------------------------------------------------
 bool PerftCommandHandle::parse(Parameters& params) {
+  divideRoot = false;
+  reference = false;
+  serial   = false;
+  verifyCache = false;
   count    = 0;
   skip     = 0;
   maxDepth = 0;
+  threads  = 1;
+  shardIndex = 0;
+  shardCount = 0;
+  hashSize = 16;
   maxLeafs = 0;
+  resume   = false;
+  cacheFile = "";
+  checkpointFile = "";
   fileName = "";
+  outPrefix = "perft-shard";
+  reportFile = "";
 
   bool epd = false;
+  bool merging = false;
   bool invalid = false;
 
   while (params.size() && !invalid) {
+    if (params.popParam("cache")) {
+      cacheFile = params.popString();
+      invalid = cacheFile.empty();
+      continue;
+    }
+    if (params.popParam("report")) {
+      reportFile = params.popString();
+      invalid = reportFile.empty();
+      continue;
+    }
+    if (params.popParam("checkpoint")) {
+      checkpointFile = params.popString();
+      invalid = checkpointFile.empty();
+      continue;
+    }
+    if (params.popParam("resume")) {
+      checkpointFile = params.popString();
+      invalid = checkpointFile.empty();
+      resume = true;
+      continue;
+    }
+    if (params.popParam("out")) {
+      outPrefix = params.popString();
+      invalid = outPrefix.empty();
+      continue;
+    }
+    if (params.popParam("shard")) {
+      // <i>/<n>, 1 <= i <= n
+      const std::string shard = params.popString();
+      const size_t slash = shard.find('/');
+      if (slash != std::string::npos) {
+        shardIndex = toNumber<int>(shard.substr(0, slash));
+        shardCount = toNumber<int>(shard.substr(slash + 1));
+      }
+      invalid = ((shardCount < 1) || (shardIndex < 1) ||
+                 (shardIndex > shardCount));
+      continue;
+    }
+    if (params.popNumber("merge", shardCount, invalid)) {
+      merging = true;
+      invalid |= (shardCount < 1);
+      continue;
+    }
     if (params.popParam("epd", epd) ||
+        params.popParam("verify-cache", verifyCache) ||
+        params.popParam("divide", divideRoot) ||
+        params.popParam("reference", reference) ||
+        params.popParam("serial", serial) ||
         params.popNumber("count", count, invalid) ||
         params.popNumber("skip",  skip, invalid) ||
         params.popNumber("depth", maxDepth, invalid) ||
+        params.popNumber("hash", hashSize, invalid) ||
         params.popNumber("leafs", maxLeafs, invalid) ||
+        params.popNumber("threads", threads, invalid) ||
         params.popString("file",  fileName))
     {
       continue;
@@ -165,338 +378,2288 @@ bool PerftCommandHandle::parse(Parameters& params) {
     return false;
   }
 
-  if (invalid) {
+  if (invalid || (threads < 1)) {
     Output() << "usage: " << usage();
     return false;
   }
 
-  if (epd && fileName.empty()) {
+  if (divideRoot && ((maxDepth < 1) || epd || fileName.size())) {
+    Output() << "divide requires a depth and uses the current position";
+    return false;
+  }
+
+  if (divideRoot && reportFile.size()) {
+    Output() << "report is not supported with divide";
+    return false;
+  }
+
+  if (verifyCache && cacheFile.empty()) {
+    Output() << "verify-cache requires a cache file";
+    return false;
+  }
+
+  if (reference && !verifyCache && (maxDepth < 1) && !epd &&
+      fileName.empty())
+  {
+    Output() << "reference requires a depth or an EPD file";
+    return false;
+  }
+
+  if ((shardCount > 0) && (divideRoot || reference || verifyCache ||
+                           reportFile.size() || cacheFile.size()))
+  {
+    Output() << "shard and merge can't be combined with divide, reference, "
+             << "cache, or report";
+    return false;
+  }
+
+  if (checkpointFile.size() && (divideRoot || verifyCache || (shardCount > 0)))
+  {
+    Output() << "checkpoint and resume can't be combined with divide, "
+             << "verify-cache, shard, or merge";
+    return false;
+  }
+
+  if ((epd || (shardCount > 0) || checkpointFile.size()) && fileName.empty()) {
     fileName = _TEST_FILE;
   }
 
+  if (!merging && (shardCount > 0) && !shardIndex) {
+    Output() << "usage: " << usage();
+    return false;
+  }
+
   return true;
 }
 
 //-----------------------------------------------------------------------------
 void PerftCommandHandle::doWork() {
-  if (fileName.empty()) {
+  if (divideRoot) {
+    divide();
+    return;
+  }
+
+  if (shardCount > 0) {
+    if (shardIndex > 0) {
+      shard();
+    }
+    else {
+      merge();
+    }
+    return;
+  }
+
+  if (cacheFile.size()) {
+    const std::string version =
+        (engine.getEngineName() + ' ' + engine.getEngineVersion());
+    if (!cache.open(cacheFile, version)) {
+      return;
+    }
+    if (verifyCache) {
+      verify();
+      return;
+    }
+  }
+
+  if (fileName.empty() && !reference && reportFile.empty()) {
     engine.perft(maxDepth);
     return;
   }
 
-  std::ifstream fs(fileName);
+  if (reportFile.size() && !jsonReport.open(reportFile)) {
+    return;
+  }
 
   const TimePoint start = now();
+  const std::string currentFEN = engine.getFEN();
+
+  // index all positions up front so they can be spread across the engine pool
+  std::vector<PerftPosition> tasks;
+  EpdFile epdFile;
+  if (fileName.empty()) {
+    tasks.push_back(
+        PerftPosition{0, currentFEN, 0, 0, 0, 0, 0, true, false, {}, {}});
+  }
+  else if (epdFile.open(fileName)) {
+    size_t end = epdFile.size();
+    if ((count > 0) && (size_t(count) < end)) {
+      end = size_t(count);
+    }
+    for (size_t i = size_t(std::max<int>(skip, 0)); i < end; ++i) {
+      const EpdFile::Record record = epdFile[i];
+      tasks.push_back(PerftPosition{record.line, record.text, 0, 0, 0, 0, 0,
+                                    true, false, {}, {}});
+    }
+  }
+
+  // completed positions are appended to the checkpoint file as they finish,
+  // when resuming they are restored instead of searched again
+  std::ofstream checkpoint;
+  if (checkpointFile.size()) {
+    const std::string header = checkpointHeader(tasks.size());
+    if (resume && !loadCheckpoint(header, tasks)) {
+      return;
+    }
+    const size_t done = static_cast<size_t>(std::count_if(
+        tasks.begin(), tasks.end(),
+        [](const PerftPosition& position) { return position.restored; }));
+    checkpoint.open(checkpointFile, (std::ios::out |
+                                     (done ? std::ios::app : std::ios::trunc)));
+    if (!checkpoint) {
+      Output() << "Cannot open " << checkpointFile;
+      return;
+    }
+    if (!done) {
+      checkpoint << "# " << fileName << '\n' << header << '\n';
+    }
+    Output() << "Checkpoint " << checkpointFile << ": "
+             << (tasks.size() - done) << " of " << tasks.size()
+             << " positions remaining, " << done << " already done";
+  }
+
+  if (threads > 1) {
+    Output() << "Using " << pool.resize(size_t(threads)) << " engine instances";
+  }
+
+  // results are output in file order regardless of which engine finishes first
   uint64_t pcount = 0;
-  bool done = false;
-  int positions = 0;
-  int line = 0;
+  uint64_t engineUsecs = 0;
+  uint64_t refCount = 0;
+  uint64_t refUsecs = 0;
+  int cacheHits = 0;
+  int finished = 0;
+  int failed = 0;
+  std::map<int, Histogram> depthUsecs;
+  std::vector<std::pair<uint64_t, size_t>> positionUsecs;
+  pool.execute(tasks.size(),
+    [this, &tasks](ChessEngine& instance, const size_t task) {
+      if (!tasks[task].restored) {
+        perft(instance, tasks[task]);
+      }
+    },
+    [&](const size_t task) {
+      const PerftPosition& position = tasks[task];
+      for (const std::string& message : position.messages) {
+        Output() << message;
+      }
+      if (position.restored) {
+        Output() << fileName << " line " << position.line << ' '
+                 << position.fen << " (from checkpoint)";
+      }
+      else if (checkpoint.is_open() && !stopFlag) {
+        // flush each result so an interrupted run loses nothing
+        checkpoint << resultLine(position, task) << std::endl;
+      }
+      pcount += position.leafs;
+      engineUsecs += position.usecs;
+      refCount += position.refLeafs;
+      refUsecs += position.refUsecs;
+      cacheHits += position.cacheHits;
+      finished++;
+      failed += (position.passed ? 0 : 1);
+      for (const PerftDepth& depth : position.depths) {
+        if (!depth.cached) {
+          depthUsecs[depth.depth].add(depth.usecs);
+        }
+      }
+      positionUsecs.push_back(std::make_pair(position.usecs, task));
+      report(position);
+      return position.passed;
+    });
+
+  double msecs = getMsecs(start, now());
+  double kLeafs = (double(pcount) / 1000);
 
-  std::string fen;
-  fen.reserve(16384);
+  Output() << "Total Perft " << pcount << ' '
+           << rate(kLeafs, msecs) << " KLeafs/sec";
 
-  while (!done && std::getline(fs, fen)) {
-    line++;
+  if (reference) {
+    // compare time spent inside perft() calls, not wall-clock time
+    // leafs per microsecond * 1000 = KLeafs/sec
+    Output() << "Reference Perft " << refCount << ' '
+             << rate(double(refCount), double(refUsecs))
+             << " KLeafs/sec, " << engine.getEngineName() << ' '
+             << rate(double(pcount), double(engineUsecs)) << " KLeafs/sec";
+  }
 
-    size_t i = fen.find_first_not_of(" \t\r\n");
-    if ((i == std::string::npos) || (fen[i] == '#')) {
-      continue;
+  if (cache.isOpen()) {
+    Output() << "Perft cache hits " << cacheHits << ", "
+             << cache.size() << " entries";
+  }
+
+  // per depth time distribution and the positions that took longest
+  static const size_t SLOWEST = 5;
+  const size_t slowest = std::min(SLOWEST, positionUsecs.size());
+  std::partial_sort(positionUsecs.begin(), (positionUsecs.begin() + slowest),
+                    positionUsecs.end(),
+                    std::greater<std::pair<uint64_t, size_t>>());
+  if (finished > 1) {
+    for (const auto& entry : depthUsecs) {
+      Output() << "Depth " << entry.first << " usecs "
+               << entry.second.summary() << " (" << entry.second.count()
+               << " positions)";
     }
+    for (size_t i = 0; i < slowest; ++i) {
+      const PerftPosition& position = tasks[positionUsecs[i].second];
+      Output() << "Slow " << (i + 1) << ": " << position.usecs
+               << " usecs, line " << position.line << ' '
+               << EpdFile::getFEN(position.fen);
+    }
+  }
 
-    positions++;
-    if ((skip > 0) && (positions <= skip)) {
-      continue;
+  if (jsonReport.isOpen()) {
+    for (const auto& entry : depthUsecs) {
+      jsonReport.write(JsonRecord()
+          .add("type", "distribution")
+          .add("metric", "usecs")
+          .add("depth", entry.first)
+          .add("count", entry.second.count())
+          .add("p50", entry.second.percentile(50))
+          .add("p90", entry.second.percentile(90))
+          .add("p99", entry.second.percentile(99))
+          .add("max", entry.second.maximum()));
+    }
+    for (size_t i = 0; i < slowest; ++i) {
+      const PerftPosition& position = tasks[positionUsecs[i].second];
+      jsonReport.write(JsonRecord()
+          .add("type", "slowest")
+          .add("line", position.line)
+          .add("fen", EpdFile::getFEN(position.fen))
+          .add("usecs", position.usecs));
     }
+    jsonReport.write(JsonRecord()
+        .add("type", "summary")
+        .add("command", "perft")
+        .add("positions", finished)
+        .add("passed", (finished - failed))
+        .add("failed", failed)
+        .add("leafs", pcount)
+        .add("cached", cacheHits)
+        .add("msecs", uint64_t(msecs))
+        .add("nps", rate(double(pcount), msecs)));
+    jsonReport.close();
+  }
+}
+
+//-----------------------------------------------------------------------------
+//! \brief Split the selected EPD positions into shard work units
+//! Each "D<depth> <leafs>" entry within range is split by root move, in
+//! sorted order, except depth 1 which is a single unit for the whole position
+//! so the engine's own root move generation is verified.  Root moves come
+//! from the reference move generator so every host produces the same units.
+//! \param[in] epdFile The EPD file
+//! \param[out] units Populated with the work units for all shards
+//! \return false if any selected line is invalid
+//-----------------------------------------------------------------------------
+bool PerftCommandHandle::collectUnits(const EpdFile& epdFile,
+                                      std::vector<ShardUnit>& units)
+{
+  size_t end = epdFile.size();
+  if ((count > 0) && (size_t(count) < end)) {
+    end = size_t(count);
+  }
 
-    Output() << fileName << " line " << line << ' ' << fen;
+  ReferenceBoard board(0);
+  for (size_t i = size_t(std::max<int>(skip, 0)); i < end; ++i) {
+    const EpdFile::Record record = epdFile[i];
     std::string remain;
-    if (!engine.setPosition(fen, &remain)) {
-      break;
+    if (!board.loadFEN(std::string(record.text), &remain)) {
+      Output() << fileName << " line " << record.line << " invalid FEN";
+      return false;
+    }
+
+    std::vector<std::string> moves;
+    for (const std::string& move : board.getMoves()) {
+      moves.push_back(move);
     }
+    std::sort(moves.begin(), moves.end());
 
-    // process "D<depth> <leafs>" parameters (e.g. D5 4865609)
+    // same "D<depth> <leafs>" rules as perft(), a line without any
+    // depth parameters is searched to maxDepth with no expected leaf count
+    std::vector<std::pair<int, uint64_t>> depths;
     Parameters params(remain);
-    while (!done && params.size()) {
+    while (params.size()) {
       std::string depthToken = trim(params.popString(), " ;");
       if (depthToken.empty() || (depthToken.at(0) != 'D')) {
         continue;
       }
-
-      int depth = toNumber<int>(depthToken.substr(1));
-      if (depth < 1) {
-        Output() << "--- invalid depth: " << depthToken;
-        break;
+      const int depth = toNumber<int>(depthToken.substr(1));
+      // leaf counts may also carry the ';' separator, e.g. "D2 191; D3 2812"
+      uint64_t leafs = 0;
+      parseNumber(trim(params.popString(), " ;"), leafs);
+      if ((depth < 1) || (leafs < 1)) {
+        Output() << fileName << " line " << record.line
+                 << " invalid depth parameter: " << depthToken;
+        return false;
       }
+      depths.push_back(std::make_pair(depth, leafs));
+    }
+    if (depths.empty() && (maxDepth > 0)) {
+      depths.push_back(std::make_pair(maxDepth, uint64_t(0)));
+    }
 
-      if (params.empty()) {
-        Output() << "--- missing expected leaf count";
-        break;
+    for (const auto& depth : depths) {
+      if (((maxDepth > 0) && (depth.first > maxDepth)) ||
+          ((maxLeafs > 0) && (depth.second > maxLeafs)))
+      {
+        continue;
       }
-
-      uint64_t leafs = params.popNumber<uint64_t>();
-      if (leafs < 1) {
-        Output() << "--- invalid expected leaf count";
-        break;
+      if (depth.first == 1) {
+        units.push_back(ShardUnit{record.line, 1, record.text, "*",
+                                  depth.second});
+        continue;
+      }
+      for (const std::string& move : moves) {
+        units.push_back(ShardUnit{record.line, depth.first, record.text, move,
+                                  depth.second});
       }
-
-      done |= !process(depth, leafs, pcount);
     }
-
-    done |= ((count > 0) && (positions >= count));
   }
+  return true;
+}
 
-  double msecs = getMsecs(start, now());
-  double kLeafs = (double(pcount) / 1000);
-
-  Output() << "Total Perft " << pcount << ' '
-           << rate(kLeafs, msecs) << " KLeafs/sec";
+//-----------------------------------------------------------------------------
+std::string PerftCommandHandle::shardFileName(const int shard) const {
+  return join(outPrefix, '.', shard, "of", shardCount);
 }
 
 //-----------------------------------------------------------------------------
-//! \brief Perform [q]perft search, \p params format = 'D<depth> <leafs>'
-//! \param[in] depth The depth to search to
-//! \param[in] expected_leaf_count The expected leaf count at \p depth
-//! \param[out] leaf_count The actual leaf count at \p depth
-//! \return false if leaf_count count does not match expected leaf count
+//! \brief Get the checkpoint file text for a completed perft position
+//! "<index> <line> <passed> <leafs> <usecs> <ref leafs> <ref usecs>
+//!  <cache hits>" followed by a "<depth>,<leafs>,<expected>,<usecs>,<cached>,
+//! <passed>" field for each depth searched.
 //-----------------------------------------------------------------------------
-bool PerftCommandHandle::process(const int depth,
-                                 const uint64_t expected_leaf_count,
-                                 uint64_t& leaf_count)
+std::string PerftCommandHandle::resultLine(const PerftPosition& position,
+                                           const size_t index)
 {
-  if ((maxDepth > 0) && (depth > maxDepth)) {
-    return true;
-  }
-
-  if ((maxLeafs > 0) && (expected_leaf_count > maxLeafs)) {
-    return true;
+  std::string line = join(index, ' ', position.line, ' ', int(position.passed),
+                          ' ', position.leafs, ' ', position.usecs, ' ',
+                          position.refLeafs, ' ', position.refUsecs, ' ',
+                          position.cacheHits);
+  for (const PerftDepth& depth : position.depths) {
+    line += join(' ', depth.depth, ',', depth.leafs, ',', depth.expected, ',',
+                 depth.usecs, ',', int(depth.cached), ',', int(depth.passed));
   }
+  return line;
+}
 
-  Output() << "--- " << depth << " => " << expected_leaf_count;
-  uint64_t perft_count = engine.perft(depth);
-  leaf_count += perft_count;
+//-----------------------------------------------------------------------------
+//! \brief Get the checkpoint file header line
+//! Includes the options that affect results, so a run can't be resumed with
+//! a different position range or search depth.
+//-----------------------------------------------------------------------------
+std::string PerftCommandHandle::checkpointHeader(const size_t positions) const
+{
+  return join("checkpoint skip ", skip, " depth ", maxDepth, " reference ",
+              int(reference), " positions ", positions);
+}
 
-  if (perft_count != expected_leaf_count) {
-    Output() << "--- " << perft_count << " != " << expected_leaf_count;
+//-----------------------------------------------------------------------------
+//! \brief Restore completed positions from the checkpoint file
+//! \param[in] header The expected header line
+//! \param[in,out] positions The perft positions, in file order
+//! \return false if the checkpoint doesn't match \p header or \p positions
+//-----------------------------------------------------------------------------
+bool PerftCommandHandle::loadCheckpoint(const std::string& header,
+                                        std::vector<PerftPosition>& positions)
+{
+  std::ifstream fs(checkpointFile);
+  if (!fs) {
+    Output() << "Cannot open " << checkpointFile;
     return false;
   }
 
+  std::string line;
+  while (std::getline(fs, line)) {
+    if (line.empty() || (line[0] == '#')) {
+      continue;
+    }
+    if (!isdigit(line[0])) {
+      if (line != header) {
+        Output() << checkpointFile << " is for different options: " << line;
+        return false;
+      }
+      continue;
+    }
+
+    Parameters params(line);
+    const size_t index = params.popNumber<size_t>();
+    const int lineNumber = params.popNumber<int>();
+    if ((params.size() < 6) || (index >= positions.size()) ||
+        (positions[index].line != lineNumber))
+    {
+      Output() << checkpointFile << " contains an invalid result: " << line;
+      return false;
+    }
+
+    PerftPosition& position = positions[index];
+    position.passed = (params.popNumber<int>() != 0);
+    position.leafs = params.popNumber<uint64_t>();
+    position.usecs = params.popNumber<uint64_t>();
+    position.refLeafs = params.popNumber<uint64_t>();
+    position.refUsecs = params.popNumber<uint64_t>();
+    position.cacheHits = params.popNumber<int>();
+    position.depths.clear();
+    while (params.size()) {
+      std::stringstream ss(params.popString());
+      std::string field;
+      std::vector<uint64_t> fields;
+      while (std::getline(ss, field, ',')) {
+        fields.push_back(toNumber<uint64_t>(field));
+      }
+      if (fields.size() != 6) {
+        Output() << checkpointFile << " contains an invalid result: " << line;
+        return false;
+      }
+      position.depths.push_back(PerftDepth{int(fields[0]), fields[1],
+                                           fields[2], fields[3],
+                                           (fields[4] != 0), (fields[5] != 0)});
+    }
+    position.restored = true;
+  }
   return true;
 }
 
 //-----------------------------------------------------------------------------
-const std::string TestCommandHandle::_TEST_FILE = "epd/test.epd";
-
+//! \brief Search the work units that belong to shardIndex of shardCount
+//! Units are assigned round-robin in file order.  Results are appended to the
+//! shard result file as they complete, one "<line> <depth> <move> <leafs>"
+//! line per unit.  Units already in the result file are not searched again,
+//! so an interrupted shard can be resumed by running the same command.
 //-----------------------------------------------------------------------------
-bool TestCommandHandle::parse(Parameters& params) {
-  noClear    = false;
-  printBoard = false;
-  maxCount   = 0;
-  maxDepth   = 0;
-  maxFails   = 0;
-  skipCount  = 0;
-  maxTime    = 0;
-  fileName   = "";
+void PerftCommandHandle::shard() {
+  EpdFile epdFile;
+  std::vector<ShardUnit> units;
+  if (!epdFile.open(fileName) || !collectUnits(epdFile, units)) {
+    return;
+  }
 
-  bool invalid = false;
-  while (params.size() && !invalid) {
-    if (params.popParam("noclear", noClear) ||
-        params.popParam("print", printBoard) ||
-        params.popNumber("count", maxCount, invalid) ||
-        params.popNumber("depth", maxDepth, invalid) ||
-        params.popNumber("fail",  maxFails, invalid) ||
-        params.popNumber("skip",  skipCount, invalid) ||
-        params.popNumber("time",  maxTime, invalid) ||
-        params.popString("file",  fileName))
-    {
-      continue;
+  const std::string outFile = shardFileName(shardIndex);
+  const std::string header = join("shard ", shardIndex, '/', shardCount,
+                                  " units ", units.size());
+
+  // load results from a previous run of this shard
+  std::set<std::string> done;
+  {
+    std::ifstream fs(outFile);
+    std::string line;
+    while (std::getline(fs, line)) {
+      if (line.empty() || (line[0] == '#')) {
+        continue;
+      }
+      if (!line.compare(0, 6, "shard ")) {
+        if (line != header) {
+          Output() << outFile << " is for a different shard or options: "
+                   << line;
+          return;
+        }
+        continue;
+      }
+      Parameters params(line);
+      const std::string unitLine = params.popString();
+      const std::string unitDepth = params.popString();
+      done.insert(join(unitLine, ' ', unitDepth, ' ', params.popString()));
     }
-    Output() << "Unexpected token: " << params.front();
-    return false;
   }
 
-  if (invalid) {
-    Output() << "usage: " << usage();
-    return false;
+  std::vector<ShardUnit*> mine;
+  for (size_t i = (shardIndex - 1); i < units.size(); i += shardCount) {
+    ShardUnit& unit = units[i];
+    if (!done.count(join(unit.line, ' ', unit.depth, ' ', unit.move))) {
+      mine.push_back(&unit);
+    }
   }
 
-  if (fileName.empty()) {
-    fileName = _TEST_FILE;
+  std::ofstream out(outFile, std::ios::out | std::ios::app);
+  if (!out) {
+    Output() << "Cannot open " << outFile;
+    return;
+  }
+  if (done.empty()) {
+    out << "# " << fileName << '\n' << header << '\n';
   }
 
-  return true;
+  Output() << "Shard " << shardIndex << '/' << shardCount << ": "
+           << mine.size() << " of " << units.size() << " units remaining, "
+           << done.size() << " already done";
+
+  if (threads > 1) {
+    Output() << "Using " << pool.resize(size_t(threads)) << " engine instances";
+  }
+
+  const TimePoint start = now();
+  std::vector<uint64_t> results(mine.size(), 0);
+  std::vector<char> valid(mine.size(), 0);
+  uint64_t pcount = 0;
+
+  pool.execute(mine.size(),
+    [&mine, &results, &valid](ChessEngine& instance, const size_t task) {
+      const ShardUnit& unit = *mine[task];
+      if (!instance.setPosition(std::string(unit.fen))) {
+        return;
+      }
+      if (unit.move == "*") {
+        results[task] = instance.perft(unit.depth);
+      }
+      else if (!instance.makeMove(unit.move)) {
+        return;
+      }
+      else {
+        results[task] = (unit.depth > 1) ? instance.perft(unit.depth - 1) : 1;
+      }
+      valid[task] = 1;
+    },
+    [this, &mine, &results, &valid, &out, &pcount](const size_t task) {
+      const ShardUnit& unit = *mine[task];
+      if (!valid[task]) {
+        Output() << "--- line " << unit.line << " invalid move " << unit.move;
+        return false;
+      }
+      if (stopFlag) {
+        return false;
+      }
+      // flush each result so an interrupted shard loses nothing
+      out << unit.line << ' ' << unit.depth << ' ' << unit.move << ' '
+          << results[task] << std::endl;
+      pcount += results[task];
+      Output() << "line " << unit.line << " depth " << unit.depth << ' '
+               << unit.move << ' ' << results[task];
+      return true;
+    });
+
+  const uint64_t msecs = getMsecs(start, now());
+  Output() << "Shard " << shardIndex << '/' << shardCount << " perft "
+           << pcount << ' ' << rate((double(pcount) / 1000), double(msecs))
+           << " KLeafs/sec, results in " << outFile;
 }
 
 //-----------------------------------------------------------------------------
-void TestCommandHandle::doWork() {
-  if (fileName.empty()) {
-    Output() << "FileName not set for 'test' command";
+//! \brief Combine shard result files and check them against the EPD counts
+//-----------------------------------------------------------------------------
+void PerftCommandHandle::merge() {
+  EpdFile epdFile;
+  std::vector<ShardUnit> units;
+  if (!epdFile.open(fileName) || !collectUnits(epdFile, units)) {
+    return;
+  }
+
+  std::map<std::string, uint64_t> results;
+  for (int shard = 1; shard <= shardCount; ++shard) {
+    const std::string inFile = shardFileName(shard);
+    const std::string header = join("shard ", shard, '/', shardCount,
+                                    " units ", units.size());
+    std::ifstream fs(inFile);
+    if (!fs) {
+      Output() << "--- missing shard file " << inFile;
+      continue;
+    }
+
+    std::string line;
+    while (std::getline(fs, line)) {
+      if (line.empty() || (line[0] == '#')) {
+        continue;
+      }
+      if (!line.compare(0, 6, "shard ")) {
+        if (line != header) {
+          Output() << inFile << " is for a different shard or options: "
+                   << line;
+          return;
+        }
+        continue;
+      }
+      Parameters params(line);
+      const std::string unitLine = params.popString();
+      const std::string unitDepth = params.popString();
+      const std::string unitMove = params.popString();
+      results[join(unitLine, ' ', unitDepth, ' ', unitMove)] =
+          params.popNumber<uint64_t>();
+    }
+  }
+
+  // units are grouped by line and depth in file order
+  int checked = 0;
+  int failed = 0;
+  int incomplete = 0;
+  size_t missing = 0;
+  uint64_t pcount = 0;
+  for (size_t i = 0; i < units.size(); ) {
+    const ShardUnit& first = units[i];
+    uint64_t leafs = 0;
+    size_t found = 0;
+    size_t total = 0;
+    for (; (i < units.size()) && (units[i].line == first.line) &&
+           (units[i].depth == first.depth); ++i, ++total)
+    {
+      const ShardUnit& unit = units[i];
+      auto it = results.find(join(unit.line, ' ', unit.depth, ' ', unit.move));
+      if (it != results.end()) {
+        leafs += it->second;
+        found++;
+      }
+    }
+
+    checked++;
+    pcount += leafs;
+    if (found < total) {
+      incomplete++;
+      missing += (total - found);
+      Output() << "--- line " << first.line << " depth " << first.depth
+               << " incomplete, " << (total - found) << " of " << total
+               << " units missing";
+    }
+    else if (first.expected && (leafs != first.expected)) {
+      failed++;
+      Output() << "--- line " << first.line << " depth " << first.depth
+               << ' ' << leafs << " != " << first.expected;
+    }
+    else {
+      Output() << "line " << first.line << " depth " << first.depth << ' '
+               << leafs << (first.expected ? " passed" : "");
+    }
+  }
+
+  Output() << "Merged " << shardCount << " shards: " << checked
+           << " results, " << (checked - failed - incomplete) << " passed, "
+           << failed << " failed, " << incomplete << " incomplete ("
+           << missing << " units missing), total perft " << pcount;
+}
+
+//-----------------------------------------------------------------------------
+//! \brief Perft the current position, splitting the work by root move
+//! Each root move is searched to maxDepth - 1 on whichever engine in the pool
+//! is available next.  Sub-totals are output in root move order.
+//-----------------------------------------------------------------------------
+void PerftCommandHandle::divide() {
+  const std::string fen = engine.getFEN();
+  std::vector<std::string> moves;
+  for (const std::string& move : engine.getLegalMoves()) {
+    moves.push_back(move);
+  }
+
+  if (moves.empty()) {
+    // engine doesn't implement getLegalMoves(), use the reference generator
+    ReferenceBoard board(0);
+    if (!board.loadFEN(fen)) {
+      return;
+    }
+    for (const std::string& move : board.getMoves()) {
+      moves.push_back(move);
+    }
+  }
+
+  if (moves.empty()) {
+    Output() << "No legal moves";
+    return;
+  }
+
+  std::sort(moves.begin(), moves.end());
+
+  if (threads > 1) {
+    Output() << "Using " << pool.resize(size_t(threads)) << " engine instances";
+  }
+
+  struct RootMove {
+    uint64_t leafs;
+    uint64_t refLeafs;
+    uint64_t msecs;
+    bool     valid;
+  };
+
+  const TimePoint start = now();
+  std::vector<RootMove> results(moves.size(), RootMove{0, 0, 0, false});
+  uint64_t pcount = 0;
+  uint64_t busyMsecs = 0;
+  bool mismatch = false;
+
+  pool.execute(moves.size(),
+    [this, &fen, &moves, &results](ChessEngine& instance, const size_t task) {
+      const TimePoint begin = now();
+      RootMove& result = results[task];
+      if (instance.setPosition(fen) && instance.makeMove(moves[task])) {
+        result.leafs = (maxDepth > 1) ? instance.perft(maxDepth - 1) : 1;
+        result.valid = true;
+      }
+      result.msecs = getMsecs(begin, now());
+
+      if (reference && result.valid) {
+        ReferenceBoard board(hashSize);
+        board.setStopFlag(&stopFlag);
+        if (board.loadFEN(fen) && board.makeMove(moves[task])) {
+          result.refLeafs = board.perft(maxDepth - 1);
+        }
+      }
+    },
+    [&](const size_t task) {
+      const RootMove& result = results[task];
+      if (!result.valid) {
+        Output() << "--- invalid root move: " << moves[task];
+        return false;
+      }
+      if (reference && (result.leafs != result.refLeafs)) {
+        Output() << moves[task] << ' ' << result.leafs << " != "
+                 << result.refLeafs << " (reference)";
+        mismatch = true;
+      }
+      else {
+        Output() << moves[task] << ' ' << result.leafs;
+      }
+      pcount += result.leafs;
+      busyMsecs += result.msecs;
+      return true;
+    });
+
+  // the pool includes this engine, put it back on the divided position
+  engine.setPosition(fen);
+
+  const uint64_t msecs = getMsecs(start, now());
+  Output() << "Total Perft " << pcount << ' '
+           << rate((double(pcount) / 1000), double(msecs)) << " KLeafs/sec";
+  Output() << "Moves " << moves.size() << ", " << msecs << " msecs, "
+           << busyMsecs << " msecs total engine time, speedup "
+           << average(busyMsecs, msecs);
+  if (mismatch) {
+    Output() << "--- reference mismatch";
+  }
+
+  if (serial && !pool.stopRequested()) {
+    // the serial path, for comparison
+    const TimePoint begin = now();
+    const uint64_t serialCount = engine.perft(maxDepth);
+    const uint64_t serialMsecs = getMsecs(begin, now());
+    Output() << "Serial Perft " << serialCount << ' '
+             << rate((double(serialCount) / 1000), double(serialMsecs))
+             << " KLeafs/sec, " << serialMsecs << " msecs, speedup "
+             << average(serialMsecs, msecs);
+    if (serialCount != pcount) {
+      Output() << "--- " << pcount << " != " << serialCount;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+//! \brief Output the given message now, or queue it if running multi-threaded
+//-----------------------------------------------------------------------------
+void PerftCommandHandle::log(PerftPosition& position,
+                             const std::string& message)
+{
+  if (pool.size() > 1) {
+    position.messages.push_back(message);
+  }
+  else {
+    Output() << message;
+  }
+}
+
+//-----------------------------------------------------------------------------
+//! \brief Write a report record for each depth searched on the given position
+//-----------------------------------------------------------------------------
+void PerftCommandHandle::report(const PerftPosition& position) {
+  if (!jsonReport.isOpen()) {
+    return;
+  }
+
+  const std::string fen = EpdFile::getFEN(position.fen);
+  for (const PerftDepth& result : position.depths) {
+    jsonReport.write(JsonRecord()
+        .add("type", "perft")
+        .add("line", position.line)
+        .add("fen", fen)
+        .add("depth", result.depth)
+        .add("leafs", result.leafs)
+        .add("expected", result.expected)
+        .add("passed", result.passed)
+        .add("cached", result.cached)
+        .add("msecs", (result.usecs / 1000))
+        .add("nps", rate(double(result.leafs * 1000), double(result.usecs))));
+  }
+}
+
+//-----------------------------------------------------------------------------
+//! \brief Perform [q]perft search for all depths listed on a single EPD line
+//! A line without "D<depth> <leafs>" parameters is searched to maxDepth.  In
+//! reference mode the result is compared against the reference move generator.
+//! \param[in] instance The engine instance to use
+//! \param[in,out] position The EPD line, updated with total leafs and status
+//-----------------------------------------------------------------------------
+void PerftCommandHandle::perft(ChessEngine& instance, PerftPosition& position)
+{
+  if (fileName.size()) {
+    log(position, join(fileName, " line ", position.line, ' ', position.fen));
+  }
+  else {
+    log(position, join("position ", position.fen));
+  }
+
+  const std::string fen(position.fen);
+  std::string remain;
+  if (!instance.setPosition(fen, &remain)) {
+    position.passed = false;
+    return;
+  }
+
+  std::unique_ptr<ReferenceBoard> ref;
+  if (reference) {
+    ref.reset(new ReferenceBoard(hashSize));
+    ref->setStopFlag(&stopFlag);
+    if (!ref->loadFEN(fen)) {
+      position.passed = false;
+      return;
+    }
+  }
+
+  // process "D<depth> <leafs>" parameters (e.g. D5 4865609)
+  bool haveDepth = false;
+  Parameters params(remain);
+  while (position.passed && params.size()) {
+    std::string depthToken = trim(params.popString(), " ;");
+    if (depthToken.empty() || (depthToken.at(0) != 'D')) {
+      continue;
+    }
+
+    haveDepth = true;
+    int depth = toNumber<int>(depthToken.substr(1));
+    if (depth < 1) {
+      log(position, join("--- invalid depth: ", depthToken));
+      break;
+    }
+
+    if (params.empty()) {
+      log(position, "--- missing expected leaf count");
+      break;
+    }
+
+    // leaf counts may also carry the ';' separator, e.g. "D2 191; D3 2812"
+    uint64_t leafs = 0;
+    parseNumber(trim(params.popString(), " ;"), leafs);
+    if (leafs < 1) {
+      log(position, "--- invalid expected leaf count");
+      break;
+    }
+
+    position.passed = process(instance, position, ref.get(), depth, leafs);
+  }
+
+  if (!haveDepth && (maxDepth > 0) && (ref || fileName.empty())) {
+    position.passed = process(instance, position, ref.get(), maxDepth, 0);
+  }
+}
+
+//-----------------------------------------------------------------------------
+//! \brief Perform [q]perft search, \p params format = 'D<depth> <leafs>'
+//! \param[in] instance The engine instance to use
+//! \param[in,out] position The EPD line, leaf count at \p depth is added
+//! \param[in] ref If not NULL the expected leaf count is taken from \p ref
+//! \param[in] depth The depth to search to
+//! \param[in] expected_leaf_count The expected leaf count at \p depth,
+//!                                0 if unknown
+//! \return false if leaf_count count does not match expected leaf count
+//-----------------------------------------------------------------------------
+bool PerftCommandHandle::process(ChessEngine& instance,
+                                 PerftPosition& position,
+                                 ReferenceBoard* ref,
+                                 const int depth,
+                                 const uint64_t expected_leaf_count)
+{
+  if ((maxDepth > 0) && (depth > maxDepth)) {
+    return true;
+  }
+
+  if ((maxLeafs > 0) && (expected_leaf_count > maxLeafs)) {
+    return true;
+  }
+
+  // skip depths that were already verified for this position
+  uint64_t cached = 0;
+  if (cache.isOpen() &&
+      cache.lookup(std::string(position.fen), depth, cached) &&
+      (!expected_leaf_count || (cached == expected_leaf_count)))
+  {
+    log(position, join("--- ", depth, " => ", cached, " (cached)"));
+    position.depths.push_back(PerftDepth{depth, cached, cached, 0, true, true});
+    position.cacheHits++;
+    return true;
+  }
+
+  // without an expected leaf count or a reference any result is accepted
+  const bool known = (expected_leaf_count || ref);
+  uint64_t expected = expected_leaf_count;
+  if (ref) {
+    const TimePoint begin = now();
+    const uint64_t ref_count = ref->perft(depth);
+    position.refUsecs += getUsecs(begin, now());
+    position.refLeafs += ref_count;
+
+    if (expected && (ref_count != expected)) {
+      log(position, join("--- reference ", ref_count, " != ", expected));
+      position.depths.push_back(
+          PerftDepth{depth, 0, expected, 0, false, false});
+      return false;
+    }
+    expected = ref_count;
+  }
+
+  if (known) {
+    log(position, join("--- ", depth, " => ", expected));
+  }
+
+  const TimePoint begin = now();
+  uint64_t perft_count = instance.perft(depth);
+  const uint64_t usecs = getUsecs(begin, now());
+  position.usecs += usecs;
+  position.leafs += perft_count;
+
+  const bool passed = (!known || (perft_count == expected));
+  position.depths.push_back(
+      PerftDepth{depth, perft_count, expected, usecs, false, passed});
+
+  if (!passed) {
+    log(position, join("--- ", perft_count, " != ", expected));
+    return false;
+  }
+
+  if (!known) {
+    log(position, join("--- ", depth, " => ", perft_count));
+  }
+  else if (cache.isOpen()) {
+    cache.store(std::string(position.fen), depth, perft_count);
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+//! \brief Re-validate a random sample of the perft cache
+//! Entries that don't match the engine's current result (or the reference
+//! result in reference mode) are removed from the cache.
+//-----------------------------------------------------------------------------
+void PerftCommandHandle::verify() {
+  const size_t sampleSize = (count > 0) ? size_t(count) : 16;
+  const uint64_t seed = uint64_t(now().time_since_epoch().count());
+  const std::vector<PerftCache::Entry> entries = cache.sample(sampleSize, seed);
+
+  Output() << "Verifying " << entries.size() << " of " << cache.size()
+           << " perft cache entries";
+
+  if (threads > 1) {
+    Output() << "Using " << pool.resize(size_t(threads)) << " engine instances";
+  }
+
+  std::vector<std::string> fens;
+  for (const PerftCache::Entry& entry : entries) {
+    fens.push_back(entry.fen + " 0 1");
+  }
+
+  std::vector<PerftPosition> tasks;
+  for (const std::string& fen : fens) {
+    tasks.push_back(PerftPosition{0, fen, 0, 0, 0, 0, 0, true, false, {}, {}});
+  }
+
+  pool.execute(tasks.size(),
+    [this, &tasks, &entries, &fens](ChessEngine& instance, const size_t task) {
+      PerftPosition& position = tasks[task];
+      const PerftCache::Entry& entry = entries[task];
+      const std::string& fen = fens[task];
+      log(position, join("depth ", entry.depth, ' ', fen));
+
+      if (reference) {
+        ReferenceBoard ref(hashSize);
+        ref.setStopFlag(&stopFlag);
+        if (ref.loadFEN(fen)) {
+          position.refLeafs = ref.perft(entry.depth);
+        }
+        if (position.refLeafs != entry.leafs) {
+          log(position, join("--- reference ", position.refLeafs,
+                             " != ", entry.leafs));
+          position.passed = false;
+          return;
+        }
+      }
+
+      if (!instance.setPosition(fen)) {
+        position.passed = false;
+        return;
+      }
+
+      position.leafs = instance.perft(entry.depth);
+      if (position.leafs != entry.leafs) {
+        log(position, join("--- ", position.leafs, " != ", entry.leafs));
+        position.passed = false;
+      }
+    },
+    [this, &tasks](const size_t task) {
+      for (const std::string& message : tasks[task].messages) {
+        Output() << message;
+      }
+      return !stopFlag;
+    });
+
+  if (stopFlag) {
+    return;
+  }
+
+  std::vector<PerftCache::Entry> invalid;
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    if (!tasks[i].passed) {
+      invalid.push_back(entries[i]);
+    }
+  }
+
+  Output() << "Verified " << tasks.size() << " perft cache entries, "
+           << invalid.size() << " invalid";
+
+  if (invalid.size() && cache.erase(invalid)) {
+    Output() << "Removed " << invalid.size() << " invalid perft cache entries";
+  }
+}
+
+//-----------------------------------------------------------------------------
+const std::string TestCommandHandle::_TEST_FILE = "epd/test.epd";
+
+//-----------------------------------------------------------------------------
+bool TestCommandHandle::parse(Parameters& params) {
+  comparing  = false;
+  noClear    = false;
+  clockBase  = 0;
+  clockInc   = 0;
+  clockMoves = 0;
+  printBoard = false;
+  maxCount   = 0;
+  maxDepth   = 0;
+  maxFails   = 0;
+  skipCount  = 0;
+  maxTime    = 0;
+  shardCount = 0;
+  shardIndex = 0;
+  stableCount = 0;
+  threads    = 1;
+  fileName   = "";
+  outPrefix  = "test-shard";
+  checkpointFile = "";
+  resume     = false;
+  reportFile = "";
+  compileFile = "";
+  solveTimes = { 100, 1000, 10000 };
+  optionsA.clear();
+  optionsB.clear();
+
+  bool invalid = false;
+  while (params.size() && !invalid) {
+    if (params.popParam("compare")) {
+      invalid = !parseOptionSet(params.popString(), optionsA) ||
+                !params.popParam("vs") ||
+                !parseOptionSet(params.popString(), optionsB);
+      comparing = !invalid;
+      continue;
+    }
+    if (params.popParam("out")) {
+      outPrefix = params.popString();
+      invalid = outPrefix.empty();
+      continue;
+    }
+    if (params.popParam("shard")) {
+      // <i>/<n>, 1 <= i <= n
+      const std::string shard = params.popString();
+      const size_t slash = shard.find('/');
+      if (slash != std::string::npos) {
+        shardIndex = toNumber<int>(shard.substr(0, slash));
+        shardCount = toNumber<int>(shard.substr(slash + 1));
+      }
+      invalid = ((shardCount < 1) || (shardIndex < 1) ||
+                 (shardIndex > shardCount));
+      continue;
+    }
+    if (params.popNumber("merge", shardCount, invalid)) {
+      shardIndex = 0;
+      invalid |= (shardCount < 1);
+      continue;
+    }
+    if (params.popParam("checkpoint")) {
+      checkpointFile = params.popString();
+      invalid = checkpointFile.empty();
+      continue;
+    }
+    if (params.popParam("resume")) {
+      checkpointFile = params.popString();
+      invalid = checkpointFile.empty();
+      resume = true;
+      continue;
+    }
+    if (params.popParam("compile")) {
+      fileName = params.popString();
+      compileFile = params.popString();
+      invalid = compileFile.empty();
+      continue;
+    }
+    if (params.popParam("clock")) {
+      invalid = !parseClock(params.popString(), clockBase, clockInc,
+                            clockMoves);
+      continue;
+    }
+    if (params.popParam("solve")) {
+      // comma separated list of time thresholds in msecs
+      std::stringstream ss(params.popString());
+      std::string token;
+      solveTimes.clear();
+      while (std::getline(ss, token, ',')) {
+        const uint64_t msecs = toNumber<uint64_t>(token);
+        invalid |= (msecs < 1);
+        solveTimes.push_back(msecs);
+      }
+      invalid |= solveTimes.empty();
+      continue;
+    }
+    if (params.popParam("report")) {
+      reportFile = params.popString();
+      invalid = reportFile.empty();
+      continue;
+    }
+    if (params.popParam("noclear", noClear) ||
+        params.popParam("print", printBoard) ||
+        params.popNumber("count", maxCount, invalid) ||
+        params.popNumber("depth", maxDepth, invalid) ||
+        params.popNumber("fail",  maxFails, invalid) ||
+        params.popNumber("skip",  skipCount, invalid) ||
+        params.popNumber("time",  maxTime, invalid) ||
+        params.popNumber("stable", stableCount, invalid) ||
+        params.popNumber("threads", threads, invalid) ||
+        params.popString("file",  fileName))
+    {
+      continue;
+    }
+    Output() << "Unexpected token: " << params.front();
+    return false;
+  }
+
+  if (invalid || (threads < 1)) {
+    Output() << "usage: " << usage();
+    return false;
+  }
+
+  if (clockBase && maxTime) {
+    Output() << "clock and time can't be combined";
+    return false;
+  }
+
+  if ((shardCount > 0) && (comparing || compileFile.size())) {
+    Output() << "shard and merge can't be combined with compare or compile";
+    return false;
+  }
+
+  if (checkpointFile.size() &&
+      ((shardCount > 0) || comparing || compileFile.size()))
+  {
+    Output() << "checkpoint and resume can't be combined with shard, merge, "
+             << "compare, or compile";
+    return false;
+  }
+
+  if (fileName.empty()) {
+    fileName = _TEST_FILE;
+  }
+
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void TestCommandHandle::doWork() {
+  if (fileName.empty()) {
+    Output() << "FileName not set for 'test' command";
+    return;
+  }
+
+  if (compileFile.size()) {
+    TestSuiteFile::compile(fileName, compileFile);
+    return;
+  }
+
+  if (reportFile.size() && !jsonReport.open(reportFile)) {
+    return;
+  }
+
+  // compiled test suites are used as-is, EPD test suites are indexed
+  EpdFile epdFile;
+  suite.close();
+  if (TestSuiteFile::isSuiteFile(fileName)) {
+    if (!suite.open(fileName)) {
+      return;
+    }
+  }
+  else if (!epdFile.open(fileName)) {
     return;
   }
 
-  std::ifstream fs(fileName);
-
   struct FailedTest {
     std::string bestmove;
     std::string fen;
     int line;
   };
 
-  int      line = 0;
-  int      maxSearchDepth = 0;
-  int      maxSeldepth = 0;
-  int      minSearchDepth = -1;
-  int      minSeldepth = -1;
-  int      passed = 0;
-  int      positions = 0;
-  int      tested = 0;
-  int      totalDepth = 0;
-  int      totalSeldepth = 0;
-  uint64_t totalNodes = 0;
-  uint64_t totalQnodes = 0;
-  uint64_t totalTime = 0;
-  MoveFinder moveFinder;
-  std::list<FailedTest> failed;
+  int      maxSearchDepth = 0;
+  int      maxSeldepth = 0;
+  int      minSearchDepth = -1;
+  int      minSeldepth = -1;
+  int      passed = 0;
+  int      tested = 0;
+  int      totalDepth = 0;
+  int      totalSeldepth = 0;
+  uint64_t totalNodes = 0;
+  uint64_t totalQnodes = 0;
+  uint64_t totalTime = 0;
+  uint64_t solveNodes = 0;
+  int      stoppedEarly = 0;
+  int      solveDepth = 0;
+  std::vector<int> solvedWithin(solveTimes.size(), 0);
+  std::list<FailedTest> failed;
+  Histogram solveHistogram;
+  Histogram msecsHistogram;
+  Histogram nodesHistogram;
+  Histogram npsHistogram;
+  Histogram seldepthHistogram;
+  Histogram usedHistogram;
+  uint64_t allocTotal = 0;
+  uint64_t usedTotal = 0;
+  int      overruns = 0;
+  int      flagged = 0;
+
+  std::vector<TestPosition> tasks;
+  const size_t first = size_t(std::max<int>(skipCount, 0));
+  const size_t records = (suite.isOpen() ? suite.size() : epdFile.size());
+  for (size_t i = first; i < records; ++i) {
+    if (maxCount && (tasks.size() >= size_t(maxCount))) {
+      break;
+    }
+    if (suite.isOpen()) {
+      const TestSuiteFile::Record record = suite[i];
+      tasks.push_back(TestPosition{i, record.line, record.text, "",
+                                   SearchStats(), SearchStats(), false,
+                                   false, false, false, 0, 0, false, {}});
+    }
+    else {
+      const EpdFile::Record record = epdFile[i];
+      tasks.push_back(TestPosition{i, record.line, record.text, "",
+                                   SearchStats(), SearchStats(), false,
+                                   false, false, false, 0, 0, false, {}});
+    }
+  }
+
+  if (comparing) {
+    compare(tasks);
+    jsonReport.close();
+    return;
+  }
+
+  // shards take every n'th position so each gets a similar mix of positions,
+  // merging restores every position from the shard result files
+  const bool merging = ((shardCount > 0) && !shardIndex);
+  std::ofstream results;
+  if (merging) {
+    for (int shard = 1; shard <= shardCount; ++shard) {
+      if (!loadResults(shardFileName(shard),
+                       shardHeader(shard, tasks.size()), tasks))
+      {
+        return;
+      }
+    }
+    int missing = 0;
+    for (const TestPosition& position : tasks) {
+      if (!position.restored) {
+        Output() << "--- no result for line " << position.line;
+        missing++;
+      }
+    }
+    if (missing) {
+      Output() << "--- " << missing << " of " << tasks.size()
+               << " positions have no result, can't merge";
+      return;
+    }
+  }
+  else if ((shardCount > 0) || checkpointFile.size()) {
+    std::string outFile = checkpointFile;
+    std::string header = checkpointHeader(tasks.size());
+    if (shardCount > 0) {
+      outFile = shardFileName(shardIndex);
+      header = shardHeader(shardIndex, tasks.size());
+      std::vector<TestPosition> mine;
+      for (size_t i = (shardIndex - 1); i < tasks.size(); i += shardCount) {
+        mine.push_back(tasks[i]);
+      }
+      tasks.swap(mine);
+    }
+
+    // positions already in the result file are not searched again, so an
+    // interrupted shard or checkpointed run can pick up where it left off
+    if (resume && !std::ifstream(outFile)) {
+      Output() << "Cannot open " << outFile;
+      return;
+    }
+    if (((shardCount > 0) || resume) && !loadResults(outFile, header, tasks)) {
+      return;
+    }
+    const size_t done = static_cast<size_t>(std::count_if(
+        tasks.begin(), tasks.end(),
+        [](const TestPosition& position) { return position.restored; }));
+    results.open(outFile, (std::ios::out |
+                           (done ? std::ios::app : std::ios::trunc)));
+    if (!results) {
+      Output() << "Cannot open " << outFile;
+      return;
+    }
+    if (!done) {
+      results << "# " << fileName << '\n' << header << '\n';
+    }
+    if (shardCount > 0) {
+      Output() << "Shard " << shardIndex << '/' << shardCount << ": "
+               << (tasks.size() - done) << " of " << tasks.size()
+               << " positions remaining, " << done << " already done";
+    }
+    else {
+      Output() << "Checkpoint " << outFile << ": "
+               << (tasks.size() - done) << " of " << tasks.size()
+               << " positions remaining, " << done << " already done";
+    }
+  }
+
+  if ((threads > 1) && !merging) {
+    Output() << "Using " << pool.resize(size_t(threads)) << " engine instances";
+  }
+  for (size_t i = 0; i < pool.size(); ++i) {
+    pool[i].resetEngineStats();
+  }
+  resetClocks();
+
+  // results are aggregated in file order regardless of which engine
+  // finishes first
+  const TimePoint start = now();
+  pool.execute(tasks.size(),
+    [this, &tasks](ChessEngine& instance, const size_t task) {
+      if (!tasks[task].restored) {
+        test(instance, tasks[task], int(task + 1));
+      }
+    },
+    [&](const size_t task) {
+      const TestPosition& position = tasks[task];
+      for (const std::string& message : position.messages) {
+        Output() << message;
+      }
+      tested++;
+      if (!position.valid) {
+        return false;
+      }
+      if (position.restored) {
+        Output() << "--- Test " << (task + 1) << " at line " << position.line
+                 << ' ' << position.fen << " (already done)";
+      }
+      else if (results.is_open() && !pool.stopRequested()) {
+        // flush each result so an interrupted run loses nothing, but don't
+        // save a search that was cut short by "stop" as finished, or a
+        // resumed run would restore it instead of searching it again
+        results << resultLine(position) << std::endl;
+      }
+
+      const std::string fen(position.fen);
+      const int line = position.line;
+      const SearchStats& stats = position.stats;
+      Output(Output::NoPrefix) << "bestmove " << position.bestmove;
+
+      if (jsonReport.isOpen()) {
+        jsonReport.write(JsonRecord()
+            .add("type", "test")
+            .add("line", line)
+            .add("fen", EpdFile::getFEN(fen))
+            .add("depth", stats.depth)
+            .add("bestmove", position.bestmove)
+            .add("passed", position.passed)
+            .add("nodes", stats.nodes)
+            .add("qnodes", stats.qnodes)
+            .add("msecs", stats.msecs)
+            .add("nps", rate(double(stats.nodes), double(stats.msecs)))
+            .add("seldepth", stats.seldepth)
+            .add("solve_msecs", position.solveStats.msecs)
+            .add("solve_nodes", position.solveStats.nodes)
+            .add("solve_depth", position.solveStats.depth)
+            .add("stopped_early", position.stoppedEarly)
+            .add("alloc_msecs", position.allocMsecs)
+            .add("used_msecs", position.usedMsecs)
+            .add("flagged", position.flagged));
+      }
+
+      maxSearchDepth = std::max<int>(maxSearchDepth, stats.depth);
+      maxSeldepth = std::max<int>(maxSeldepth, stats.seldepth);
+      if ((minSearchDepth < 0) || (stats.depth < minSearchDepth)) {
+        minSearchDepth = stats.depth;
+      }
+      if ((minSeldepth < 0) || (stats.seldepth < minSeldepth)) {
+        minSeldepth = stats.seldepth;
+      }
+      totalDepth += stats.depth;
+      totalNodes += stats.nodes;
+      totalQnodes += stats.qnodes;
+      totalSeldepth += stats.seldepth;
+      totalTime += stats.msecs;
+      msecsHistogram.add(stats.msecs);
+      nodesHistogram.add(stats.nodes);
+      npsHistogram.add(uint64_t(rate(double(stats.nodes),
+                                     double(stats.msecs))));
+      seldepthHistogram.add(uint64_t(std::max<int>(stats.seldepth, 0)));
+      if (clockBase) {
+        allocTotal += position.allocMsecs;
+        usedTotal += position.usedMsecs;
+        usedHistogram.add(position.usedMsecs);
+        overruns += (position.usedMsecs > position.allocMsecs) ? 1 : 0;
+        flagged += position.flagged ? 1 : 0;
+      }
+
+      if (!position.passed) {
+        Output() << "--- FAILED! line " << line << " ("
+                 << percent(passed, tested) << "%) " << fen;
+
+        failed.push_back(FailedTest{position.bestmove, fen, line});
+        if ((maxFails > 0) && (failed.size() >= size_t(maxFails))) {
+          return false;
+        }
+      }
+      else {
+        passed++;
+        Output() << "--- Passed. line " << line << " ("
+                 << percent(passed, tested) << "%) " << fen;
+        if (position.stoppedEarly) {
+          stoppedEarly++;
+          Output() << "--- Stopped after " << stableCount
+                   << " stable iterations";
+        }
+        Output() << "--- Solved at " << position.solveStats.msecs
+                 << " msecs, " << position.solveStats.nodes << " nodes, depth "
+                 << position.solveStats.depth;
+        solveHistogram.add(position.solveStats.msecs);
+        for (size_t i = 0; i < solveTimes.size(); ++i) {
+          if (position.solveStats.msecs <= solveTimes[i]) {
+            solvedWithin[i]++;
+          }
+        }
+        solveNodes += position.solveStats.nodes;
+        solveDepth += position.solveStats.depth;
+      }
+
+      return !pool.stopRequested();
+    });
+
+  Output() << "--- Completed " << tested << " test positions";
+  Output() << "--- Passed    " << passed << " passed ("
+           << percent(passed, tested) << "%)";
+  Output() << "--- Time      " << totalTime << " ("
+           << average(totalTime, static_cast<uint64_t>(tested)) << " avg)";
+  Output() << "--- Nodes     " << totalNodes << ", "
+           << rate((totalNodes / 1000), totalTime) << " KNodes/sec";
+  Output() << "--- QNodes    " << totalQnodes << " ("
+           << percent(totalQnodes, totalNodes) << "%)";
+  Output() << "--- Depth     " << minSearchDepth << " min, "
+           << static_cast<int>(average(totalDepth, tested)) << " avg, "
+           << maxSearchDepth << " max";
+  Output() << "--- SelDepth  " << minSeldepth << " min, "
+           << static_cast<int>(average(totalSeldepth, tested)) << " avg, "
+           << maxSeldepth << " max";
+
+  // per position distributions, averages hide the slow tail
+  Output() << "--- Time/pos  " << msecsHistogram.summary();
+  Output() << "--- Nodes/pos " << nodesHistogram.summary();
+  Output() << "--- NPS/pos   " << npsHistogram.summary();
+  Output() << "--- Sel/pos   " << seldepthHistogram.summary();
+
+  // time to solution
+  Output() << "--- Solve ms  " << solveHistogram.summary();
+  Output() << "--- Solve at  "
+           << static_cast<uint64_t>(average(solveNodes, uint64_t(passed)))
+           << " nodes avg, "
+           << static_cast<int>(average(solveDepth, passed)) << " depth avg";
+  if (stableCount > 0) {
+    Output() << "--- Stable    " << stoppedEarly << " stopped after "
+             << stableCount << " stable iterations";
+  }
+  for (size_t i = 0; i < solveTimes.size(); ++i) {
+    Output() << "--- Within    " << solveTimes[i] << " msecs: "
+             << solvedWithin[i] << " solved ("
+             << percent(solvedWithin[i], tested) << "%)";
+  }
 
-  std::string fen;
-  fen.reserve(16384);
+  // time management under a simulated game clock
+  if (clockBase) {
+    Output() << "--- Clock     "
+             << (clockMoves ? join(clockMoves, " moves in ") : "")
+             << clockBase << " + " << clockInc << " msecs";
+    Output() << "--- Allocated " << allocTotal << " ("
+             << average(allocTotal, static_cast<uint64_t>(tested)) << " avg)";
+    Output() << "--- Used      " << usedTotal << " ("
+             << average(usedTotal, static_cast<uint64_t>(tested)) << " avg, "
+             << percent(usedTotal, allocTotal) << "% of allocated)";
+    Output() << "--- Used/pos  " << usedHistogram.summary();
+    Output() << "--- Overruns  " << overruns << " ("
+             << percent(overruns, tested) << "%) used more than allocated";
+    Output() << "--- Flagged   " << flagged << " ("
+             << percent(flagged, tested) << "%) lost on time";
+  }
 
-  engine.resetEngineStats();
+  if ((pool.size() > 1) && !merging) {
+    // search time above is the sum of all engine instances
+    const uint64_t msecs = getMsecs(start, now());
+    Output() << "--- Elapsed   " << msecs << " msecs on " << pool.size()
+             << " engines, " << rate((totalNodes / 1000), msecs)
+             << " KNodes/sec";
+  }
 
-  while (std::getline(fs, fen)) {
-    line++;
+  if (jsonReport.isOpen()) {
+    jsonReport.write(JsonRecord()
+        .add("type", "summary")
+        .add("command", "test")
+        .add("positions", tested)
+        .add("passed", passed)
+        .add("failed", (tested - passed))
+        .add("nodes", totalNodes)
+        .add("qnodes", totalQnodes)
+        .add("msecs", totalTime)
+        .add("nps", rate(double(totalNodes), double(totalTime)))
+        .add("depth", average(double(totalDepth), double(tested)))
+        .add("seldepth", average(double(totalSeldepth), double(tested)))
+        .add("solve_p50", solveHistogram.percentile(50))
+        .add("solve_p90", solveHistogram.percentile(90))
+        .add("solve_p99", solveHistogram.percentile(99)));
+    const std::pair<const char*, const Histogram*> histograms[] = {
+      { "msecs", &msecsHistogram }, { "nodes", &nodesHistogram },
+      { "nps", &npsHistogram }, { "seldepth", &seldepthHistogram }
+    };
+    for (const auto& histogram : histograms) {
+      jsonReport.write(JsonRecord()
+          .add("type", "distribution")
+          .add("metric", histogram.first)
+          .add("count", histogram.second->count())
+          .add("p50", histogram.second->percentile(50))
+          .add("p90", histogram.second->percentile(90))
+          .add("p99", histogram.second->percentile(99))
+          .add("max", histogram.second->maximum()));
+    }
+    if (clockBase) {
+      jsonReport.write(JsonRecord()
+          .add("type", "clock")
+          .add("base", clockBase)
+          .add("inc", clockInc)
+          .add("moves", clockMoves)
+          .add("alloc_msecs", allocTotal)
+          .add("used_msecs", usedTotal)
+          .add("used_p50", usedHistogram.percentile(50))
+          .add("used_p90", usedHistogram.percentile(90))
+          .add("used_p99", usedHistogram.percentile(99))
+          .add("overruns", overruns)
+          .add("flagged", flagged)
+          .add("passed", passed)
+          .add("positions", tested));
+    }
+    for (size_t i = 0; i < solveTimes.size(); ++i) {
+      jsonReport.write(JsonRecord()
+          .add("type", "solved")
+          .add("msecs", solveTimes[i])
+          .add("solved", solvedWithin[i])
+          .add("positions", tested));
+    }
+    jsonReport.close();
+  }
 
-    size_t i = fen.find_first_not_of(" \t\r\n");
-    if ((i == std::string::npos) || (fen[i] == '#')) {
-      continue;
+  for (size_t i = 0; (i < pool.size()) && !merging; ++i) {
+    if (pool.size() > 1) {
+      Output() << "--- Everaged Engine Statistics (engine " << (i + 1)
+               << ") ---";
+    }
+    else {
+      Output() << "--- Everaged Engine Statistics ---";
     }
+    pool[i].showEngineStats();
+  }
+
+  for (const auto& fail : failed) {
+    Output() << "--- Failed line " << fail.line << ' ' << fail.fen;
+    Output() << "--- Engine move: " << fail.bestmove;
+    if (printBoard || engine.isDebugOn()) {
+      engine.setPosition(fail.fen);
+      engine.printBoard();
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+//! \brief Get the result file text for a completed test position
+//! "<record> <line> <bestmove> <passed> <stopped early> <depth> <seldepth>
+//!  <nodes> <qnodes> <msecs> <solve depth> <solve nodes> <solve msecs>
+//!  <allocated msecs> <used msecs> <flagged>"
+//-----------------------------------------------------------------------------
+std::string TestCommandHandle::resultLine(const TestPosition& position) {
+  const SearchStats& stats = position.stats;
+  const SearchStats& solve = position.solveStats;
+  return join(position.record, ' ', position.line, ' ',
+              (position.bestmove.empty() ? "-" : position.bestmove), ' ',
+              int(position.passed), ' ', int(position.stoppedEarly), ' ',
+              stats.depth, ' ', stats.seldepth, ' ', stats.nodes, ' ',
+              stats.qnodes, ' ', stats.msecs, ' ',
+              solve.depth, ' ', solve.nodes, ' ', solve.msecs, ' ',
+              position.allocMsecs, ' ', position.usedMsecs, ' ',
+              int(position.flagged));
+}
+
+//-----------------------------------------------------------------------------
+std::string TestCommandHandle::shardFileName(const int shard) const {
+  return join(outPrefix, '.', shard, "of", shardCount);
+}
+
+//-----------------------------------------------------------------------------
+//! \brief Get the search limits that results saved to a file depend on
+//! Part of the checkpoint and shard file headers, so a run can't be resumed
+//! or merged with different search limits.
+//-----------------------------------------------------------------------------
+std::string TestCommandHandle::limitsHeader() const {
+  return join("depth ", maxDepth, " time ", maxTime, " clock ", clockMoves,
+              '/', clockBase, '+', clockInc, " stable ", stableCount,
+              " noclear ", int(noClear));
+}
+
+//-----------------------------------------------------------------------------
+//! \brief Get the checkpoint file header line
+//-----------------------------------------------------------------------------
+std::string TestCommandHandle::checkpointHeader(const size_t positions) const {
+  return join("checkpoint ", limitsHeader(), " positions ", positions);
+}
+
+//-----------------------------------------------------------------------------
+std::string TestCommandHandle::shardHeader(const int shard,
+                                           const size_t positions) const
+{
+  return join("shard ", shard, '/', shardCount, ' ', limitsHeader(),
+              " positions ", positions);
+}
 
-    positions++;
-    if (skipCount && (positions <= skipCount)) {
+//-----------------------------------------------------------------------------
+//! \brief Restore test positions from a result file
+//! A missing result file is not an error, there's simply nothing to restore.
+//! \param[in] file The result file name
+//! \param[in] header The expected header line
+//! \param[in,out] positions The test positions, in record order
+//! \return false if the file doesn't match \p header or \p positions
+//-----------------------------------------------------------------------------
+bool TestCommandHandle::loadResults(const std::string& file,
+                                    const std::string& header,
+                                    std::vector<TestPosition>& positions)
+{
+  std::ifstream fs(file);
+  std::string line;
+  while (std::getline(fs, line)) {
+    if (line.empty() || (line[0] == '#')) {
+      continue;
+    }
+    if (!isdigit(line[0])) {
+      if (line != header) {
+        Output() << file << " is for a different shard or options: " << line;
+        return false;
+      }
       continue;
     }
 
-    Output() << "--- Test " << (++tested) << " at line " << line << ' ' << fen;
-    std::string remain;
-    if (!moveFinder.loadFEN(fen) || !engine.setPosition(fen, &remain)) {
-      break;
+    Parameters params(line);
+    if (params.size() != 16) {
+      Output() << file << " contains an invalid result: " << line;
+      return false;
+    }
+    const size_t record = params.popNumber<size_t>();
+    const int lineNumber = params.popNumber<int>();
+    auto it = std::lower_bound(positions.begin(), positions.end(), record,
+        [](const TestPosition& position, const size_t value) {
+          return (position.record < value);
+        });
+    if ((it == positions.end()) || (it->record != record) ||
+        (it->line != lineNumber))
+    {
+      Output() << file << " contains a result for an unexpected position: "
+               << line;
+      return false;
     }
 
-    // consume 'am' and 'bm' parameters
-    Parameters params(remain);
-    std::set<std::string> avoid;
-    std::set<std::string> best;
-    while (params.size()) {
-      if (params.popParam("am")) {
-        while (params.size()) {
-          std::string coord = moveFinder.toCoordinates(params.front());
-          if (coord.size()) {
-            params.pop_front();
-            avoid.insert(coord);
-          }
-          else {
-            break;
-          }
-        }
+    TestPosition& position = *it;
+    position.bestmove = params.popString();
+    if (position.bestmove == "-") {
+      position.bestmove.clear();
+    }
+    position.passed = (params.popNumber<int>() != 0);
+    position.stoppedEarly = (params.popNumber<int>() != 0);
+    position.stats.depth = params.popNumber<int>();
+    position.stats.seldepth = params.popNumber<int>();
+    position.stats.nodes = params.popNumber<uint64_t>();
+    position.stats.qnodes = params.popNumber<uint64_t>();
+    position.stats.msecs = params.popNumber<uint64_t>();
+    position.solveStats.depth = params.popNumber<int>();
+    position.solveStats.nodes = params.popNumber<uint64_t>();
+    position.solveStats.msecs = params.popNumber<uint64_t>();
+    position.allocMsecs = params.popNumber<uint64_t>();
+    position.usedMsecs = params.popNumber<uint64_t>();
+    position.flagged = (params.popNumber<int>() != 0);
+    position.valid = true;
+    position.restored = true;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+//! \brief Parse a "[<moves>/]<secs>+<inc>" time control, e.g. "40/60+0.5"
+//! \param[in] spec The time control
+//! \param[out] base Starting clock time in milliseconds
+//! \param[out] inc Increment per move in milliseconds
+//! \param[out] moves Moves per time control, 0 = sudden death
+//! \return false if \p spec is malformed
+//-----------------------------------------------------------------------------
+bool TestCommandHandle::parseClock(const std::string& spec, uint64_t& base,
+                                   uint64_t& inc, int& moves)
+{
+  std::string clock = spec;
+  moves = 0;
+  const size_t slash = clock.find('/');
+  if (slash != std::string::npos) {
+    moves = toNumber<int>(clock.substr(0, slash));
+    if (moves < 1) {
+      return false;
+    }
+    clock = clock.substr(slash + 1);
+  }
+
+  const size_t plus = clock.find('+');
+  const double secs = toNumber<double>(clock.substr(0, plus), -1);
+  const double incSecs = (plus == std::string::npos)
+      ? 0 : toNumber<double>(clock.substr(plus + 1), -1);
+  if ((secs <= 0) || (incSecs < 0)) {
+    return false;
+  }
+  base = static_cast<uint64_t>((secs * 1000) + 0.5);
+  inc = static_cast<uint64_t>((incSecs * 1000) + 0.5);
+  return (base > 0);
+}
+
+//-----------------------------------------------------------------------------
+//! \brief Give every engine in the pool a fresh game clock
+//-----------------------------------------------------------------------------
+void TestCommandHandle::resetClocks() {
+  clocks.clear();
+  for (size_t i = 0; i < pool.size(); ++i) {
+    clocks[&pool[i]] = GameClock{clockBase, clockMoves};
+  }
+}
+
+//-----------------------------------------------------------------------------
+//! \brief Parse a comma separated list of name=value engine option settings
+//! A single '-' is an empty set, meaning the engine's current option values.
+//! \param[in] spec The option settings, e.g. "Hash=64,Threads=1"
+//! \param[out] options The parsed option settings
+//! \return false if \p spec is malformed
+//-----------------------------------------------------------------------------
+bool TestCommandHandle::parseOptionSet(const std::string& spec,
+                                       OptionSet& options)
+{
+  options.clear();
+  if (spec == "-") {
+    return true;
+  }
+
+  std::stringstream ss(spec);
+  std::string token;
+  while (std::getline(ss, token, ',')) {
+    const size_t eq = token.find('=');
+    if ((eq == std::string::npos) || (eq == 0)) {
+      Output() << "Invalid option setting: " << token;
+      return false;
+    }
+    options.push_back(std::make_pair(token.substr(0, eq),
+                                     token.substr(eq + 1)));
+  }
+  return !options.empty();
+}
+
+//-----------------------------------------------------------------------------
+std::string TestCommandHandle::toString(const OptionSet& options) {
+  std::string str;
+  for (const auto& option : options) {
+    str += (str.empty() ? "" : ",") + option.first + '=' + option.second;
+  }
+  return str.empty() ? "-" : str;
+}
+
+//-----------------------------------------------------------------------------
+bool TestCommandHandle::applyOptions(ChessEngine& instance,
+                                     const OptionSet& options)
+{
+  for (const auto& option : options) {
+    if (!instance.setEngineOption(option.first, option.second)) {
+      Output() << "Unable to set option " << option.first << " to "
+               << option.second;
+      return false;
+    }
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+//! \brief Put the options of every engine in the pool back the way they were
+//-----------------------------------------------------------------------------
+void TestCommandHandle::restoreOptions(const OptionSet& original) {
+  for (size_t i = 0; i < pool.size(); ++i) {
+    applyOptions(pool[i], original);
+  }
+}
+
+//-----------------------------------------------------------------------------
+//! \brief Search every position with option set A and with option set B
+//! Both searches of a position run side by side on separate engine instances
+//! and the paired differences are summarized with 95% confidence intervals.
+//! \param[in] positions The test positions
+//-----------------------------------------------------------------------------
+void TestCommandHandle::compare(const std::vector<TestPosition>& positions) {
+  // remember current values so they can be restored when finished
+  OptionSet original;
+  const std::list<EngineOption> engineOptions = engine.getOptions();
+  for (const OptionSet* options : { &optionsA, &optionsB }) {
+    for (const auto& option : *options) {
+      auto it = std::find_if(engineOptions.begin(), engineOptions.end(),
+          [&option](const EngineOption& opt) {
+            return iEqual(opt.getName(), option.first);
+          });
+      if (it == engineOptions.end()) {
+        Output() << "Unknown option: " << option.first;
+        return;
       }
-      else if (params.popParam("bm")) {
-        while (params.size()) {
-          std::string coord = moveFinder.toCoordinates(params.front());
-          if (coord.size()) {
-            params.pop_front();
-            best.insert(coord);
-          }
-          else {
-            break;
-          }
-        }
+      original.push_back(std::make_pair(it->getName(), it->getValue()));
+    }
+  }
+
+  // half the engines use option set A and the other half option set B
+  if (pool.resize(size_t(std::max<int>((threads & ~1), 2))) < 2) {
+    Output() << "compare requires at least 2 engine instances";
+    return;
+  }
+  Output() << "Using " << pool.size() << " engine instances";
+
+  // even numbered engines use option set A, odd numbered engines use option
+  // set B, the options are applied once and stay put for the whole run
+  for (size_t i = 0; i < pool.size(); ++i) {
+    if (!applyOptions(pool[i], ((i & 1) ? optionsB : optionsA))) {
+      restoreOptions(original);
+      return;
+    }
+  }
+  resetClocks();
+
+  // even tasks go to the A engines, odd tasks go to the B engines, so both
+  // searches of a position are normally in progress at the same time
+  std::vector<TestPosition> tasks;
+  for (const TestPosition& position : positions) {
+    tasks.push_back(position);
+    tasks.push_back(position);
+  }
+
+  std::vector<double> nodesA, nodesB;
+  std::vector<double> msecsA, msecsB;
+  std::vector<double> npsA, npsB;
+  std::vector<double> passA, passB;
+
+  pool.execute(tasks.size(),
+    [&](ChessEngine& instance, const size_t task) {
+      test(instance, tasks[task], int(task / 2) + 1);
+    },
+    [&](const size_t task) {
+      for (const std::string& message : tasks[task].messages) {
+        Output() << message;
       }
-      else {
-        params.pop_front();
+      if (!tasks[task].valid) {
+        return false;
+      }
+      if (!(task & 1)) {
+        return !pool.stopRequested();
       }
-    }
 
-    if (avoid.empty() && best.empty()) {
-      Output() << "error at line " << line
-               << ", no best or avoid moves specified";
-      break;
+      const TestPosition& a = tasks[task - 1];
+      const TestPosition& b = tasks[task];
+      Output() << "--- Line " << b.line << " A: " << a.bestmove
+               << (a.passed ? " passed, " : " failed, ") << a.stats.nodes
+               << " nodes, " << a.stats.msecs << " msecs  B: " << b.bestmove
+               << (b.passed ? " passed, " : " failed, ") << b.stats.nodes
+               << " nodes, " << b.stats.msecs << " msecs";
+
+      nodesA.push_back(double(a.stats.nodes));
+      nodesB.push_back(double(b.stats.nodes));
+      msecsA.push_back(double(a.stats.msecs));
+      msecsB.push_back(double(b.stats.msecs));
+      npsA.push_back(rate(double(a.stats.nodes), double(a.stats.msecs)));
+      npsB.push_back(rate(double(b.stats.nodes), double(b.stats.msecs)));
+      passA.push_back(a.passed ? 100 : 0);
+      passB.push_back(b.passed ? 100 : 0);
+
+      if (jsonReport.isOpen()) {
+        jsonReport.write(JsonRecord()
+            .add("type", "compare")
+            .add("line", b.line)
+            .add("fen", EpdFile::getFEN(b.fen))
+            .add("a_bestmove", a.bestmove)
+            .add("a_passed", a.passed)
+            .add("a_depth", a.stats.depth)
+            .add("a_nodes", a.stats.nodes)
+            .add("a_msecs", a.stats.msecs)
+            .add("b_bestmove", b.bestmove)
+            .add("b_passed", b.passed)
+            .add("b_depth", b.stats.depth)
+            .add("b_nodes", b.stats.nodes)
+            .add("b_msecs", b.stats.msecs));
+      }
+      return !pool.stopRequested();
+    },
+    2);
+
+  restoreOptions(original);
+
+  const PairedDiff nodes = pairedDiff(nodesA, nodesB);
+  const PairedDiff msecs = pairedDiff(msecsA, msecsB);
+  const PairedDiff nps = pairedDiff(npsA, npsB);
+  const PairedDiff pass = pairedDiff(passA, passB);
+
+  Output() << "--- Compared  " << nodesA.size() << " positions, A: "
+           << toString(optionsA) << "  B: " << toString(optionsB);
+  Output() << "--- Nodes     " << format(nodes);
+  Output() << "--- Time ms   " << format(msecs);
+  Output() << "--- NPS       " << format(nps);
+  Output() << "--- Passed %  " << format(pass, 1);
+  Output() << "--- Intervals are 95% confidence, * = significant difference";
+
+  if (jsonReport.isOpen()) {
+    const std::pair<const char*, const PairedDiff*> metrics[] = {
+      { "nodes", &nodes }, { "msecs", &msecs }, { "nps", &nps },
+      { "passed", &pass }
+    };
+    for (const auto& metric : metrics) {
+      jsonReport.write(JsonRecord()
+          .add("type", "compare_summary")
+          .add("metric", metric.first)
+          .add("positions", uint64_t(nodesA.size()))
+          .add("a", metric.second->meanA)
+          .add("b", metric.second->meanB)
+          .add("diff", metric.second->diff)
+          .add("margin", metric.second->margin)
+          .add("significant", metric.second->significant()));
     }
+  }
+}
 
-    if (!noClear) {
-      engine.clearSearchData();
+//-----------------------------------------------------------------------------
+//! \brief Output the given message now, or queue it if running multi-threaded
+//-----------------------------------------------------------------------------
+void TestCommandHandle::log(TestPosition& position,
+                            const std::string& message)
+{
+  if (pool.size() > 1) {
+    position.messages.push_back(message);
+  }
+  else {
+    Output() << message;
+  }
+}
+
+//-----------------------------------------------------------------------------
+//! \brief Search a single test position
+//! \param[in] instance The engine instance to use
+//! \param[in,out] position The EPD line, updated with the search results
+//! \param[in] number The test number
+//-----------------------------------------------------------------------------
+void TestCommandHandle::test(ChessEngine& instance, TestPosition& position,
+                             const int number)
+{
+  const std::string fen(position.fen);
+  const int line = position.line;
+  log(position, join("--- Test ", number, " at line ", line, ' ', fen));
+
+  std::set<std::string> avoid;
+  std::set<std::string> best;
+  if (suite.isOpen()) {
+    // solutions were converted to coordinate notation by "test compile"
+    const TestSuiteFile::Record record = suite[position.record];
+    if (!instance.setPosition(std::string(record.fen))) {
+      return;
     }
-    if (printBoard && !engine.isDebugOn()) {
-      engine.printBoard();
+    for (int i = 0; i < record.bestCount; ++i) {
+      best.insert(std::string(record.bestMove(i)));
+    }
+    for (int i = 0; i < record.avoidCount; ++i) {
+      avoid.insert(std::string(record.avoidMove(i)));
+    }
+  }
+  else {
+    MoveFinder moveFinder;
+    std::string remain;
+    if (!moveFinder.loadFEN(fen) || !instance.setPosition(fen, &remain)) {
+      return;
     }
+    TestSuiteFile::getSolutions(moveFinder, remain, best, avoid);
+  }
 
-    GoParams goParams;
-    goParams.depth = maxDepth;
-    goParams.movetime = maxTime;
+  if (avoid.empty() && best.empty()) {
+    log(position, join("error at line ", line,
+                       ", no best or avoid moves specified"));
+    return;
+  }
 
-    const std::string bestmove = engine.go(goParams);
-    SearchStats stats = engine.getSearchStats();
-    Output(Output::NoPrefix) << "bestmove " << bestmove;
+  if (!noClear) {
+    instance.clearSearchData();
+  }
+  if (printBoard && !instance.isDebugOn()) {
+    instance.printBoard();
+  }
 
-    if (bestmove.empty() ||
-        (best.size() && !best.count(bestmove)) ||
-        (avoid.size() && avoid.count(bestmove)))
-    {
-      Output() << "--- FAILED! line " << line << " ("
-               << percent(passed, tested) << "%) " << fen;
+  std::function<bool(const std::string&)> isSolution =
+      [&best, &avoid](const std::string& move) {
+    return !(move.empty() ||
+             (best.size() && !best.count(move)) ||
+             (avoid.size() && avoid.count(move)));
+  };
 
-      failed.push_back(FailedTest{bestmove, fen, line});
-      if ((maxFails > 0) && (failed.size() >= size_t(maxFails))) {
-        break;
+  // record best move changes reported by the engine during the search,
+  // and stop early once the solution has been stable for long enough
+  struct TestObserver : public SearchObserver {
+    TestObserver(ChessEngine& engine,
+                 const std::function<bool(const std::string&)>& isSolution,
+                 const int stable)
+      : engine(engine), isSolution(isSolution), stable(stable), streak(0) { }
+    void bestMoveChanged(const std::string& move, const SearchStats& stats) {
+      changes.push_back(std::make_pair(move, stats));
+    }
+    void iterationComplete(const std::string& move, const SearchStats&) {
+      streak = isSolution(move) ? (streak + 1) : 0;
+      if ((stable > 0) && (streak >= stable)) {
+        engine.stopSearching();
       }
     }
+    ChessEngine& engine;
+    const std::function<bool(const std::string&)>& isSolution;
+    const int stable;
+    int streak;
+    std::vector<std::pair<std::string, SearchStats>> changes;
+  } observer(instance, isSolution, stableCount);
+
+  GoParams goParams;
+  goParams.depth = maxDepth;
+  goParams.movetime = maxTime;
+
+  // each engine instance plays its own game, its clock carries over from one
+  // position to the next and starts over when it runs out
+  GameClock* clock = nullptr;
+  if (clockBase) {
+    clock = &clocks.find(&instance)->second;
+    goParams.wtime = goParams.btime = clock->remaining;
+    goParams.winc = goParams.binc = clockInc;
+    goParams.movestogo = clockMoves ? clock->movesToGo : 0;
+
+    // nominal allocation is an even share of the remaining time plus the
+    // increment, assuming 40 moves to go in sudden death games
+    const int moves = (clockMoves ? clock->movesToGo : 40);
+    position.allocMsecs = std::min<uint64_t>(
+        clock->remaining, ((clock->remaining / uint64_t(moves)) + clockInc));
+  }
+
+  const TimePoint start = now();
+  instance.setSearchObserver(&observer);
+  position.bestmove = instance.go(goParams);
+  position.usedMsecs = getMsecs(start, now());
+  position.stats = instance.getSearchStats();
+  instance.setSearchObserver(nullptr);
+
+  if (clock) {
+    log(position, join("--- Clock ", clock->remaining, " msecs, allocated ",
+                       position.allocMsecs, ", used ", position.usedMsecs));
+    if (position.usedMsecs > clock->remaining) {
+      log(position, "--- Lost on time, starting a new game");
+      position.flagged = true;
+      *clock = GameClock{clockBase, clockMoves};
+    }
     else {
-      passed++;
-      Output() << "--- Passed. line " << line << " ("
-               << percent(passed, tested) << "%) " << fen;
+      clock->remaining -= position.usedMsecs;
+      clock->remaining += clockInc;
+      if (clockMoves && (--clock->movesToGo < 1)) {
+        clock->movesToGo = clockMoves;
+        clock->remaining += clockBase;
+      }
+    }
+  }
+  position.stoppedEarly =
+      ((stableCount > 0) && (observer.streak >= stableCount));
+
+  position.valid = true;
+  position.passed = isSolution(position.bestmove);
+  if (position.passed) {
+    // solved when the solution became the best move and never changed after,
+    // or at the end of the search if the engine doesn't report changes
+    position.solveStats = position.stats;
+    for (size_t i = observer.changes.size();
+         (i > 0) && isSolution(observer.changes[i - 1].first); --i)
+    {
+      position.solveStats = observer.changes[i - 1].second;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+const int BenchCommandHandle::_DEFAULT_DEPTH = 8;
+
+//-----------------------------------------------------------------------------
+//! \brief Positions searched by "bench" when no file is given
+//! Changing this list changes the bench signature of every engine.
+//-----------------------------------------------------------------------------
+const char* BenchCommandHandle::_POSITIONS[] = {
+  "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+  "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3",
+  "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+  "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+  "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+  "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+  "2rr3k/pp3pp1/1nnqbN1p/3pN3/2pP4/2P3Q1/PPB4P/R4RK1 w - - 0 1",
+  "r1bq2rk/pp3pbp/2p1p1pQ/7P/3P4/2PB1N2/PP3PPR/2KR4 w - - 0 1",
+  "5k2/6pp/p1qN4/1p1p4/3P4/2PKP2Q/PP3r2/3R4 b - - 0 1",
+  "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1",
+  "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+  "8/k7/3p4/p2P1p2/P2P1P2/8/8/K7 w - - 0 1",
+  nullptr
+};
+
+//-----------------------------------------------------------------------------
+bool BenchCommandHandle::parse(Parameters& params) {
+  stopFlag = false;
+  passed   = true;
+  maxDepth = 0;
+  maxNodes = 0;
+  expected = "";
+  fileName = "";
+
+  bool invalid = false;
+  while (params.size() && !invalid) {
+    if (params.popParam("signature")) {
+      expected = params.popString();
+      invalid = expected.empty();
+      continue;
+    }
+    if (params.popNumber("depth", maxDepth, invalid) ||
+        params.popNumber("nodes", maxNodes, invalid) ||
+        params.popString("file", fileName))
+    {
+      continue;
     }
+    Output() << "Unexpected token: " << params.front();
+    return false;
+  }
+
+  if (invalid || (maxDepth < 0)) {
+    Output() << "usage: " << usage();
+    return false;
+  }
+
+  if (!maxDepth && !maxNodes) {
+    maxDepth = _DEFAULT_DEPTH;
+  }
+
+  return true;
+}
 
-    maxSearchDepth = std::max<int>(maxSearchDepth, stats.depth);
-    maxSeldepth = std::max<int>(maxSeldepth, stats.seldepth);
-    if ((minSearchDepth < 0) || (stats.depth < minSearchDepth)) {
-      minSearchDepth = stats.depth;
+//-----------------------------------------------------------------------------
+//! \brief Search every bench position with a fixed depth and/or node limit
+//! Search data is cleared and the engine is limited to one thread before each
+//! position so the node counts, and therefore the signature, only change when
+//! search behavior changes.
+//-----------------------------------------------------------------------------
+void BenchCommandHandle::doWork() {
+  std::vector<std::string> fens;
+  if (fileName.size()) {
+    EpdFile epdFile;
+    if (!epdFile.open(fileName)) {
+      passed = false;
+      return;
     }
-    if ((minSeldepth < 0) || (stats.seldepth < minSeldepth)) {
-      minSeldepth = stats.seldepth;
+    for (size_t i = 0; i < epdFile.size(); ++i) {
+      fens.push_back(EpdFile::getFEN(epdFile[i].text));
     }
-    totalDepth += stats.depth;
-    totalNodes += stats.nodes;
-    totalQnodes += stats.qnodes;
-    totalSeldepth += stats.seldepth;
-    totalTime += stats.msecs;
+  }
+  else {
+    for (const char** fen = _POSITIONS; *fen; ++fen) {
+      fens.push_back(*fen);
+    }
+  }
+
+  // node counts from multi-threaded searches aren't repeatable
+  std::string threadsOption;
+  std::string threadsValue;
+  for (const EngineOption& opt : engine.getOptions()) {
+    if (iEqual(opt.getName(), "Threads")) {
+      threadsOption = opt.getName();
+      threadsValue = opt.getValue();
+      engine.setEngineOption(threadsOption, "1");
+    }
+  }
 
-    if (engine.stopRequested() || (maxCount && (tested >= maxCount))) {
+  GoParams goParams;
+  goParams.depth = maxDepth;
+  goParams.nodes = maxNodes;
+
+  // FNV-1a hash of every position's node count, so changes that happen to
+  // cancel out in the total still change the signature
+  uint64_t signature = 14695981039346656037ULL;
+  uint64_t totalNodes = 0;
+  uint64_t totalTime = 0;
+  size_t searched = 0;
+  for (; (searched < fens.size()) && !stopFlag; ++searched) {
+    const std::string& fen = fens[searched];
+    Output() << "--- Position " << (searched + 1) << '/' << fens.size()
+             << ' ' << fen;
+    if (!engine.setPosition(fen)) {
+      passed = false;
       break;
     }
+
+    engine.clearSearchData();
+    const std::string bestmove = engine.go(goParams);
+    const SearchStats stats = engine.getSearchStats();
+    Output() << "--- bestmove " << bestmove << ", " << stats.nodes
+             << " nodes, " << stats.msecs << " msecs";
+
+    totalNodes += stats.nodes;
+    totalTime += stats.msecs;
+    for (int i = 0; i < 64; i += 8) {
+      signature ^= ((stats.nodes >> i) & 0xFF);
+      signature *= 1099511628211ULL;
+    }
   }
 
-  Output() << "--- Completed " << tested << " test positions";
-  Output() << "--- Passed    " << passed << " passed ("
-           << percent(passed, tested) << "%)";
-  Output() << "--- Time      " << totalTime << " ("
-           << average(totalTime, static_cast<uint64_t>(tested)) << " avg)";
-  Output() << "--- Nodes     " << totalNodes << ", "
-           << rate((totalNodes / 1000), totalTime) << " KNodes/sec";
-  Output() << "--- QNodes    " << totalQnodes << " ("
-           << percent(totalQnodes, totalNodes) << "%)";
-  Output() << "--- Depth     " << minSearchDepth << " min, "
-           << static_cast<int>(average(totalDepth, tested)) << " avg, "
-           << maxSearchDepth << " max";
-  Output() << "--- SelDepth  " << minSeldepth << " min, "
-           << static_cast<int>(average(totalSeldepth, tested)) << " avg, "
-           << maxSeldepth << " max";
-  Output() << "--- Everaged Engine Statistics ---";
-  engine.showEngineStats();
+  if (threadsOption.size()) {
+    engine.setEngineOption(threadsOption, threadsValue);
+  }
 
-  for (const auto& fail : failed) {
-    Output() << "--- Failed line " << fail.line << ' ' << fail.fen;
-    Output() << "--- Engine move: " << fail.bestmove;
-    if (printBoard || engine.isDebugOn()) {
-      engine.setPosition(fail.fen);
-      engine.printBoard();
+  if (searched < fens.size()) {
+    Output() << "--- bench incomplete, " << searched << " of " << fens.size()
+             << " positions searched";
+    passed = false;
+    return;
+  }
+
+  char hex[17];
+  snprintf(hex, sizeof(hex), "%016llx",
+           static_cast<unsigned long long>(signature));
+
+  Output() << "--- Positions " << fens.size();
+  Output() << "--- Limits    depth " << maxDepth << ", nodes " << maxNodes;
+  Output() << "--- Time      " << totalTime << " msecs";
+  Output() << "--- Nodes     " << totalNodes;
+  Output() << "--- NPS       "
+           << static_cast<uint64_t>(rate(totalNodes, totalTime));
+  Output() << "--- Signature " << hex;
+
+  if (expected.size()) {
+    passed = iEqual(expected, hex);
+    if (passed) {
+      Output() << "--- Signature matches";
+    }
+    else {
+      Output() << "--- Signature MISMATCH, expected " << expected;
     }
   }
 }
@@ -24,12 +24,24 @@
 #define SENJO_BACKGROUND_COMMAND_H
 
 #include "ChessEngine.h"
+#include "EnginePool.h"
+#include "JsonReport.h"
+#include "PerftCache.h"
+#include "TestSuiteFile.h"
 #include "Parameters.h"
 #include "GoParams.h"
+#include "Histogram.h"
 #include "Thread.h"
+#include <atomic>
+#include <functional>
+#include <map>
+#include <string_view>
 
 namespace senjo {
 
+class EpdFile;
+class ReferenceBoard;
+
 //-----------------------------------------------------------------------------
 //! \brief Base class for a command that should run on a background thread
 //-----------------------------------------------------------------------------
@@ -69,6 +81,13 @@ public:
   //--------------------------------------------------------------------------
   virtual bool parse(Parameters& params) = 0;
 
+  //--------------------------------------------------------------------------
+  //! \brief Did the last execution of this command succeed?
+  //! Used to set the exit status when a command is run from the command line.
+  //! \return false if the command detected a failure
+  //--------------------------------------------------------------------------
+  virtual bool succeeded() const { return true; }
+
 protected:
   ChessEngine& engine;
 };
@@ -97,12 +116,83 @@ private:
   std::string name;
 };
 
+//-----------------------------------------------------------------------------
+//! \brief Wrapper for a background command added with
+//! UCIAdapter::registerCommand()
+//-----------------------------------------------------------------------------
+class CustomCommandHandle : public BackgroundCommand {
+public:
+  typedef std::function<void(Parameters& params)> Handler;
+
+  CustomCommandHandle(ChessEngine& eng, const std::string& commandName,
+                      const Handler& commandHandler)
+    : BackgroundCommand(eng),
+      name(commandName),
+      handler(commandHandler)
+  { }
+  std::string usage() const {
+    return name + " [<params>]";
+  }
+  std::string description() const {
+    return "Engine specific command.";
+  }
+  void stop() {
+    engine.stopSearching();
+  }
+
+protected:
+  bool parse(Parameters& params);
+  void doWork();
+
+private:
+  std::string name;
+  Handler handler;
+  Parameters params;
+};
+
+//-----------------------------------------------------------------------------
+//! \brief Thread safe record of the time from "stop" to "bestmove"
+//-----------------------------------------------------------------------------
+class StopLatency {
+public:
+  //--------------------------------------------------------------------------
+  //! \brief Record one stop to bestmove time
+  //! \param[in] usecs Microseconds from stop request to bestmove output
+  //--------------------------------------------------------------------------
+  void add(const uint64_t usecs) {
+    std::lock_guard<std::mutex> lock(mutex);
+    histogram.add(usecs);
+  }
+
+  //--------------------------------------------------------------------------
+  //! \brief Get all recorded times
+  //! \return Copy of the histogram of recorded times, in microseconds
+  //--------------------------------------------------------------------------
+  Histogram get() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return histogram;
+  }
+
+private:
+  std::mutex mutex;
+  Histogram histogram;
+};
+
 //-----------------------------------------------------------------------------
 //! \brief Wrapper for the UCI "go" command
 //-----------------------------------------------------------------------------
 class GoCommandHandle : public BackgroundCommand {
 public:
-  GoCommandHandle(ChessEngine& eng) : BackgroundCommand(eng) { }
+  //--------------------------------------------------------------------------
+  //! \brief Constructor
+  //! \param[in] eng The chess engine to use while executing
+  //! \param[in] latency Where to record the time from stop() to bestmove
+  //--------------------------------------------------------------------------
+  GoCommandHandle(ChessEngine& eng, StopLatency* latency = nullptr)
+    : BackgroundCommand(eng),
+      latency(latency),
+      stopTime(TimePoint())
+  { }
   std::string usage() const {
     return "go [infinite] [ponder] [depth <x>] [nodes <x>] "
         "[wtime <x>] [btime <x>] [winc <x>] [binc <x>] "
@@ -112,6 +202,8 @@ public:
     return "Find the best move for the current position.";
   }
   void stop() {
+    TimePoint none;
+    stopTime.compare_exchange_strong(none, now());
     engine.stopSearching();
   }
 
@@ -121,6 +213,8 @@ protected:
 
 private:
   GoParams goParams;
+  StopLatency* latency;
+  std::atomic<TimePoint> stopTime;
 };
 
 //-----------------------------------------------------------------------------
@@ -128,16 +222,22 @@ private:
 //-----------------------------------------------------------------------------
 class PerftCommandHandle : public BackgroundCommand {
 public:
-  PerftCommandHandle(ChessEngine& eng) : BackgroundCommand(eng) { }
+  PerftCommandHandle(ChessEngine& eng)
+    : BackgroundCommand(eng), pool(eng), stopFlag(false) { }
   std::string usage() const {
     return ("perft [unsorted] [depth <x>] [count <x>] [skip <x>] [leafs <x>] "
+            "[threads <x>] [divide [serial]] [reference [hash <mb>]] "
+            "[cache <x> [verify-cache]] [report <x>] "
+            "[shard <i>/<n>] [merge <n>] [out <x>] "
+            "[checkpoint <x>] [resume <x>] "
             "[epd] [file <x> (default=" + _TEST_FILE + ")]");
   }
   std::string description() const {
     return "Execute performance test.";
   }
   void stop() {
-    engine.stopSearching();
+    stopFlag = true;
+    pool.stopSearching();
   }
 
 protected:
@@ -145,17 +245,81 @@ protected:
   void doWork();
 
 private:
-  bool process(const int depth, const uint64_t expected_leaf_count,
-               uint64_t& leaf_count);
+  struct PerftDepth {
+    int         depth;
+    uint64_t    leafs;
+    uint64_t    expected;
+    uint64_t    usecs;
+    bool        cached;
+    bool        passed;
+  };
+
+  struct PerftPosition {
+    int              line;
+    std::string_view fen;
+    uint64_t         leafs;
+    uint64_t         usecs;
+    uint64_t         refLeafs;
+    uint64_t         refUsecs;
+    int              cacheHits;
+    bool             passed;
+    bool             restored;
+    std::list<std::string> messages;
+    std::list<PerftDepth> depths;
+  };
+
+  struct ShardUnit {
+    int              line;
+    int              depth;
+    std::string_view fen;
+    std::string      move;
+    uint64_t         expected;
+  };
+
+  static std::string resultLine(const PerftPosition& position,
+                                const size_t index);
+
+  std::string checkpointHeader(const size_t positions) const;
+  bool loadCheckpoint(const std::string& header,
+                      std::vector<PerftPosition>& positions);
+  bool collectUnits(const EpdFile& epdFile, std::vector<ShardUnit>& units);
+  std::string shardFileName(const int shard) const;
+  void shard();
+  void merge();
+  void divide();
+  void log(PerftPosition& position, const std::string& message);
+  void report(const PerftPosition& position);
+  void verify();
+  void perft(ChessEngine& instance, PerftPosition& position);
+  bool process(ChessEngine& instance, PerftPosition& position,
+               ReferenceBoard* ref, const int depth,
+               const uint64_t expected_leaf_count);
 
   static const std::string _TEST_FILE;
 
+  EnginePool  pool;
+  PerftCache  cache;
+  JsonReport  jsonReport;
+  std::atomic<bool> stopFlag;
+  bool        divideRoot;
+  bool        reference;
+  bool        resume;
+  bool        serial;
   bool        unsorted;
+  bool        verifyCache;
   int         count;
   int         skip;
   int         maxDepth;
+  int         threads;
+  int         shardIndex;
+  int         shardCount;
+  size_t      hashSize;
   uint64_t    maxLeafs;
+  std::string cacheFile;
+  std::string checkpointFile;
   std::string fileName;
+  std::string outPrefix;
+  std::string reportFile;
 };
 
 //-----------------------------------------------------------------------------
@@ -163,16 +327,21 @@ private:
 //-----------------------------------------------------------------------------
 class TestCommandHandle : public BackgroundCommand {
 public:
-  TestCommandHandle(ChessEngine& eng) : BackgroundCommand(eng) { }
+  TestCommandHandle(ChessEngine& eng) : BackgroundCommand(eng), pool(eng) { }
   std::string usage() const {
     return "test [print] [skip <x>] [count <x>] [depth <x>] [time <msecs>] "
-        "[fail <x>] [file <x> (default=" + _TEST_FILE + ")]";
+        "[clock [<moves>/]<secs>+<inc>] [fail <x>] [threads <x>] [stable <x>] [solve <msecs,...>] "
+        "[report <x>] [compile <epd> <out>] "
+        "[compare <name=value,...> vs <name=value,...>] "
+        "[shard <i>/<n>] [merge <n>] [out <x>] "
+        "[checkpoint <x>] [resume <x>] "
+        "[file <x> (default=" + _TEST_FILE + ")]";
   }
   std::string description() const {
     return "Find the best move for a suite of test positions.";
   }
   void stop() {
-    engine.stopSearching();
+    pool.stopSearching();
   }
 
 protected:
@@ -180,16 +349,117 @@ protected:
   void doWork();
 
 private:
+  struct TestPosition {
+    size_t           record;
+    int              line;
+    std::string_view fen;
+    std::string      bestmove;
+    SearchStats      stats;
+    SearchStats      solveStats;
+    bool             valid;
+    bool             passed;
+    bool             stoppedEarly;
+    bool             restored;
+    uint64_t         allocMsecs;
+    uint64_t         usedMsecs;
+    bool             flagged;
+    std::list<std::string> messages;
+  };
+
+  struct GameClock {
+    uint64_t remaining;
+    int      movesToGo;
+  };
+
+  typedef std::vector<std::pair<std::string, std::string>> OptionSet;
+
+  static bool parseClock(const std::string& spec, uint64_t& base,
+                         uint64_t& inc, int& moves);
+  static bool parseOptionSet(const std::string& spec, OptionSet& options);
+  static std::string toString(const OptionSet& options);
+  static bool applyOptions(ChessEngine& instance, const OptionSet& options);
+  void restoreOptions(const OptionSet& original);
+
+  static std::string resultLine(const TestPosition& position);
+
+  std::string limitsHeader() const;
+  std::string checkpointHeader(const size_t positions) const;
+  std::string shardFileName(const int shard) const;
+  std::string shardHeader(const int shard, const size_t positions) const;
+  bool loadResults(const std::string& file, const std::string& header,
+                   std::vector<TestPosition>& positions);
+  void compare(const std::vector<TestPosition>& positions);
+  void resetClocks();
+  void log(TestPosition& position, const std::string& message);
+  void test(ChessEngine& instance, TestPosition& position, const int number);
+
   static const std::string _TEST_FILE;
 
+  EnginePool  pool;
+  JsonReport  jsonReport;
+  TestSuiteFile suite;
+  OptionSet   optionsA;
+  OptionSet   optionsB;
+  std::map<const ChessEngine*, GameClock> clocks;
+  bool        comparing;
   bool        noClear;
+  bool        resume;
   bool        printBoard;
+  int         clockMoves;
   int         maxCount;
   int         maxDepth;
   int         maxFails;
+  int         shardCount;
+  int         shardIndex;
   int         skipCount;
+  int         stableCount;
+  int         threads;
+  uint64_t    clockBase;
+  uint64_t    clockInc;
   uint64_t    maxTime;
   std::string fileName;
+  std::string outPrefix;
+  std::string checkpointFile;
+  std::string reportFile;
+  std::string compileFile;
+  std::vector<uint64_t> solveTimes;
+};
+
+//-----------------------------------------------------------------------------
+//! \brief Wrapper for the "bench" command (not a UCI command)
+//-----------------------------------------------------------------------------
+class BenchCommandHandle : public BackgroundCommand {
+public:
+  BenchCommandHandle(ChessEngine& eng)
+    : BackgroundCommand(eng), stopFlag(false), passed(true) { }
+  std::string usage() const {
+    return "bench [depth <x> (default=" + std::to_string(_DEFAULT_DEPTH) +
+        ")] [nodes <x>] [signature <x>] [file <x>]";
+  }
+  std::string description() const {
+    return "Search a fixed set of positions, "
+        "output total nodes, node count signature, and NPS.";
+  }
+  void stop() {
+    stopFlag = true;
+    engine.stopSearching();
+  }
+  bool succeeded() const { return passed; }
+
+protected:
+  bool parse(Parameters& params);
+  void doWork();
+
+private:
+  static const int _DEFAULT_DEPTH;
+  static const char* _POSITIONS[];
+
+  std::atomic<bool> stopFlag;
+  bool        passed;
+  int         maxDepth;
+  uint64_t    maxNodes;
+  std::string expected;
+  std::string fileName;
 };
 
 } // namespace senjo
@@ -21,6 +21,7 @@
 //-----------------------------------------------------------------------------
 
 #include "ChessEngine.h"
+#include "Output.h"
 
 namespace senjo {
 
@@ -28,6 +29,11 @@ namespace senjo {
 const std::string ChessEngine::STARTPOS =
     "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
 
+//-----------------------------------------------------------------------------
+std::unique_ptr<ChessEngine> ChessEngine::createInstance() const {
+  return nullptr;
+}
+
 //-----------------------------------------------------------------------------
 std::string ChessEngine::getEmailAddress() const {
   return "";
@@ -38,6 +44,11 @@ std::string ChessEngine::getCountryName() const {
   return "";
 }
 
+//-----------------------------------------------------------------------------
+std::list<std::string> ChessEngine::getLegalMoves() {
+  return std::list<std::string>();
+}
+
 //-----------------------------------------------------------------------------
 bool ChessEngine::isRegistered() const {
   return true;
@@ -72,4 +83,35 @@ void ChessEngine::resetEngineStats() {
 void ChessEngine::showEngineStats() const {
 }
 
+//-----------------------------------------------------------------------------
+void ChessEngine::setSearchObserver(SearchObserver* observer) {
+  searchObserver = observer;
+}
+
+//-----------------------------------------------------------------------------
+void ChessEngine::notifyBestMove(const std::string& move,
+                                 const SearchStats& stats) const
+{
+  if (searchObserver) {
+    searchObserver->bestMoveChanged(move, stats);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void ChessEngine::notifyIteration(const std::string& move,
+                                  const SearchStats& stats) const
+{
+  if (searchObserver) {
+    searchObserver->iterationComplete(move, stats);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void ChessEngine::reportInfo(const InfoLine& info) const {
+  if (searchObserver) {
+    searchObserver->infoReported(info);
+  }
+  Output::write(info);
+}
+
 } // namespace senjo
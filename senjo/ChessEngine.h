@@ -25,7 +25,9 @@
 
 #include "EngineOption.h"
 #include "GoParams.h"
+#include "SearchObserver.h"
 #include "SearchStats.h"
+#include <memory>
 
 namespace senjo {
 
@@ -36,6 +38,7 @@ namespace senjo {
 //-----------------------------------------------------------------------------
 class ChessEngine {
 public:
+  ChessEngine() : searchObserver(nullptr) {}
   virtual ~ChessEngine() {}
 
   //---------------------------------------------------------------------------
@@ -44,6 +47,17 @@ public:
   //---------------------------------------------------------------------------
   static const std::string STARTPOS;
 
+  //---------------------------------------------------------------------------
+  //! \brief Create a new, independent instance of this engine
+  //! Batch commands such as "perft threads <x>" use this to spread work across
+  //! multiple engine instances, one per thread.  The new instance must not
+  //! share any search state with this instance.  It does not need to be
+  //! initialized, and option values are copied to it by the caller.
+  //! \remark Override to enable multi-threaded batch commands.
+  //! \return A new engine instance, nullptr if not supported (the default)
+  //---------------------------------------------------------------------------
+  virtual std::unique_ptr<ChessEngine> createInstance() const;
+
   //---------------------------------------------------------------------------
   //! \brief Get the engine name
   //! \return The engine name
@@ -126,6 +140,14 @@ public:
   //---------------------------------------------------------------------------
   virtual bool makeMove(const std::string& move) = 0;
 
+  //---------------------------------------------------------------------------
+  //! \brief Get all legal moves for the current position
+  //! Moves should be in coordinate notation (e.g. "e2e4", "g8f6", "e7f8q").
+  //! \remark Override to enable the "perft divide" command.
+  //! \return The legal moves, an empty list if not supported (the default)
+  //---------------------------------------------------------------------------
+  virtual std::list<std::string> getLegalMoves();
+
   //---------------------------------------------------------------------------
   //! \brief Get a FEN string representation of the current board position
   //! \return A FEN string representation of the current board postiion
@@ -272,6 +294,44 @@ public:
   //!         the "test" command is run.
   //--------------------------------------------------------------------------
   virtual void showEngineStats() const;
+
+  //--------------------------------------------------------------------------
+  //! \brief Set the observer to notify of changes during go()
+  //! \param[in] observer The observer to notify, nullptr to remove it
+  //--------------------------------------------------------------------------
+  void setSearchObserver(SearchObserver* observer);
+
+protected:
+  //--------------------------------------------------------------------------
+  //! \brief Call from go() whenever the best move changes
+  //! Commands such as "test" use this to measure how long it took to find
+  //! the solution, e.g. "test" records when the expected move was first
+  //! chosen and never changed afterwards.
+  //! \remark Call this to support time-to-solution metrics.
+  //! \param[in] move The new best move in coordinate notation
+  //! \param[in] stats Search statistics at the time of the change
+  //--------------------------------------------------------------------------
+  void notifyBestMove(const std::string& move, const SearchStats& stats) const;
+
+  //--------------------------------------------------------------------------
+  //! \brief Call from go() at the end of each iterative deepening iteration
+  //! Commands such as "test stable <x>" use this to stop searching early.
+  //! \remark Call this to support early termination of test positions.
+  //! \param[in] move The best move at the end of the iteration
+  //! \param[in] stats Search statistics at the end of the iteration
+  //--------------------------------------------------------------------------
+  void notifyIteration(const std::string& move, const SearchStats& stats) const;
+
+  //--------------------------------------------------------------------------
+  //! \brief Call from go() to report search progress
+  //! Writes \p info to stdout (subject to Output::setInfoInterval()) and
+  //! passes it to the search observer, if any.
+  //! \param[in] info The search progress to report
+  //--------------------------------------------------------------------------
+  void reportInfo(const InfoLine& info) const;
+
+private:
+  SearchObserver* searchObserver;
 };
 
 } // namespace senjo
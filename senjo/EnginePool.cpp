@@ -0,0 +1,153 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2019 Shawn Chidester <zd3nik@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include "EnginePool.h"
+#include "Output.h"
+
+namespace senjo {
+
+//-----------------------------------------------------------------------------
+EnginePool::EnginePool(ChessEngine& primary)
+  : stopped(false),
+    groupCount(1),
+    taskCount(0),
+    nextFinish(0),
+    work(nullptr),
+    finish(nullptr)
+{
+  engines.push_back(&primary);
+}
+
+//-----------------------------------------------------------------------------
+size_t EnginePool::resize(const size_t count) {
+  ChessEngine& primary = *engines.front();
+  while ((engines.size() < count) && !stopped) {
+    std::unique_ptr<ChessEngine> instance = primary.createInstance();
+    if (!instance) {
+      Output() << primary.getEngineName()
+               << " does not support multiple engine instances";
+      break;
+    }
+
+    for (const auto& opt : primary.getOptions()) {
+      if (opt.getType() != EngineOption::Button) {
+        instance->setEngineOption(opt.getName(), opt.getValue());
+      }
+    }
+
+    instance->setDebug(primary.isDebugOn());
+    if (!instance->isInitialized()) {
+      instance->initialize();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    engines.push_back(instance.get());
+    instances.push_back(std::move(instance));
+  }
+  return engines.size();
+}
+
+//-----------------------------------------------------------------------------
+void EnginePool::execute(const size_t count,
+                         const Work& workFunction,
+                         const Finish& finishFunction,
+                         const size_t groups)
+{
+  if (!groups || (groups > engines.size())) {
+    Output() << "Can't split " << engines.size() << " engine instances into "
+             << groups << " groups";
+    return;
+  }
+
+  if (engines.size() == 1) {
+    for (size_t task = 0; (task < count) && !stopped; ++task) {
+      workFunction(*engines.front(), task);
+      if (!finishFunction(task)) {
+        break;
+      }
+    }
+    return;
+  }
+
+  completed.assign(count, 0);
+  taskCount = count;
+  groupCount = groups;
+  nextTask = std::vector<std::atomic<size_t>>(groups);
+  for (std::atomic<size_t>& next : nextTask) {
+    next = 0;
+  }
+  nextFinish = 0;
+  work = &workFunction;
+  finish = &finishFunction;
+
+  std::list<std::unique_ptr<Worker>> workers;
+  for (size_t i = 0; i < engines.size(); ++i) {
+    workers.push_back(std::unique_ptr<Worker>(
+        new Worker(*this, *engines[i], (i % groups))));
+    workers.back()->run();
+  }
+  for (auto& worker : workers) {
+    worker->waitForFinish();
+  }
+
+  work = nullptr;
+  finish = nullptr;
+}
+
+//-----------------------------------------------------------------------------
+void EnginePool::workLoop(ChessEngine& engine, const size_t group) {
+  while (!stopped) {
+    const size_t task = (group + (groupCount * nextTask[group]++));
+    if (task >= taskCount) {
+      break;
+    }
+
+    (*work)(engine, task);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    completed[task] = 1;
+    while ((nextFinish < taskCount) && completed[nextFinish]) {
+      if (!(*finish)(nextFinish++)) {
+        // abandon remaining tasks and cut short the ones in progress
+        for (std::atomic<size_t>& next : nextTask) {
+          next = taskCount;
+        }
+        nextFinish = taskCount;
+        for (ChessEngine* other : engines) {
+          other->stopSearching();
+        }
+        break;
+      }
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+void EnginePool::stopSearching() {
+  std::lock_guard<std::mutex> lock(mutex);
+  stopped = true;
+  for (ChessEngine* engine : engines) {
+    engine->stopSearching();
+  }
+}
+
+} // namespace senjo
@@ -0,0 +1,147 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2019 Shawn Chidester <zd3nik@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef SENJO_ENGINE_POOL_H
+#define SENJO_ENGINE_POOL_H
+
+#include "ChessEngine.h"
+#include "Thread.h"
+#include <atomic>
+#include <functional>
+#include <vector>
+
+namespace senjo {
+
+//-----------------------------------------------------------------------------
+//! \brief A set of independent chess engine instances for batch commands
+//! The first engine in the pool is always the engine the pool was constructed
+//! with.  Additional engines are created with ChessEngine::createInstance().
+//! Each engine in the pool is driven by its own thread during execute().
+//-----------------------------------------------------------------------------
+class EnginePool {
+public:
+  //--------------------------------------------------------------------------
+  //! \brief Function called on a worker thread to process one task
+  //! \param[in] engine The engine instance owned by the worker thread
+  //! \param[in] task The task index, 0 through taskCount - 1
+  //--------------------------------------------------------------------------
+  typedef std::function<void(ChessEngine& engine, const size_t task)> Work;
+
+  //--------------------------------------------------------------------------
+  //! \brief Function called once per completed task, in task order
+  //! Calls are serialized, so it's safe to produce output from this function.
+  //! \param[in] task The task index, 0 through taskCount - 1
+  //! \return false to abandon all remaining tasks
+  //--------------------------------------------------------------------------
+  typedef std::function<bool(const size_t task)> Finish;
+
+  //--------------------------------------------------------------------------
+  //! \brief Constructor
+  //! \param[in] primary The first engine in the pool
+  //--------------------------------------------------------------------------
+  explicit EnginePool(ChessEngine& primary);
+
+  //--------------------------------------------------------------------------
+  //! \brief Grow the pool to the given number of engines
+  //! New engines have the primary engine's option values and debug setting,
+  //! and are initialized before they are added to the pool.
+  //! \param[in] count The desired number of engines
+  //! \return The number of engines in the pool, which will be less than
+  //!         \p count if the primary engine doesn't support createInstance()
+  //--------------------------------------------------------------------------
+  size_t resize(const size_t count);
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the number of engines in the pool
+  //! \return The number of engines in the pool
+  //--------------------------------------------------------------------------
+  size_t size() const { return engines.size(); }
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the engine at the given index
+  //! \param[in] index The engine index, 0 is the primary engine
+  //! \return Reference to the engine at \p index
+  //--------------------------------------------------------------------------
+  ChessEngine& operator[](const size_t index) { return *engines.at(index); }
+
+  //--------------------------------------------------------------------------
+  //! \brief Execute \p taskCount tasks across all engines in the pool
+  //! Each engine is given one task at a time until all tasks are done,
+  //! finish() returns false, or stopSearching() is called.  When the pool
+  //! contains a single engine tasks are executed on the calling thread.
+  //!
+  //! With more than one group engine N only executes tasks whose index
+  //! modulo \p groups equals N modulo \p groups, so the engines in each
+  //! group can be configured differently for the whole run.  The pool must
+  //! have at least \p groups engines.
+  //! \param[in] taskCount The number of tasks to execute
+  //! \param[in] work Function that processes one task
+  //! \param[in] finish Function called once per completed task, in order
+  //! \param[in] groups The number of engine groups
+  //--------------------------------------------------------------------------
+  void execute(const size_t taskCount, const Work& work, const Finish& finish,
+               const size_t groups = 1);
+
+  //--------------------------------------------------------------------------
+  //! \brief Stop all engines and abandon any tasks that haven't been started
+  //! Once stopped the pool will not execute any more tasks.
+  //--------------------------------------------------------------------------
+  void stopSearching();
+
+  //--------------------------------------------------------------------------
+  //! \brief Was stopSearching() called?
+  //! \return true if stopSearching() was called
+  //--------------------------------------------------------------------------
+  bool stopRequested() const { return stopped; }
+
+private:
+  class Worker : public Thread {
+  public:
+    Worker(EnginePool& pool, ChessEngine& engine, const size_t group)
+      : pool(pool), engine(engine), group(group) {}
+    void stop() {}
+  protected:
+    void doWork() { pool.workLoop(engine, group); }
+  private:
+    EnginePool&  pool;
+    ChessEngine& engine;
+    const size_t group;
+  };
+
+  void workLoop(ChessEngine& engine, const size_t group);
+
+  std::vector<ChessEngine*> engines;
+  std::vector<std::unique_ptr<ChessEngine>> instances;
+  std::vector<char> completed;
+  std::atomic<bool> stopped;
+  std::vector<std::atomic<size_t>> nextTask; //!< next task in each group
+  std::mutex mutex;
+  size_t groupCount;
+  size_t taskCount;
+  size_t nextFinish;
+  const Work* work;
+  const Finish* finish;
+};
+
+} // namespace senjo
+
+#endif // SENJO_ENGINE_POOL_H
@@ -0,0 +1,95 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2019 Shawn Chidester <zd3nik@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//-----------------------------------------------------------------------------
+
+
+#include "EpdFile.h"
+
+namespace senjo {
+
+//-----------------------------------------------------------------------------
+bool EpdFile::open(const std::string& fileName) {
+  index.clear();
+  if (!file.open(fileName)) {
+    return false;
+  }
+  buildIndex();
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void EpdFile::close() {
+  index.clear();
+  file.close();
+}
+
+//-----------------------------------------------------------------------------
+void EpdFile::buildIndex() {
+  const char* data = file.data();
+  const char* end = (data + file.size());
+  const char* p = data;
+  int line = 0;
+
+  while (p < end) {
+    line++;
+    const char* eol =
+        static_cast<const char*>(memchr(p, '\n', size_t(end - p)));
+    if (!eol) {
+      eol = end;
+    }
+
+    // trim leading and trailing white space (including '\r')
+    const char* begin = p;
+    const char* last = eol;
+    while ((begin < last) && isspace(static_cast<unsigned char>(*begin))) {
+      begin++;
+    }
+    while ((last > begin) && isspace(static_cast<unsigned char>(last[-1]))) {
+      last--;
+    }
+
+    if ((begin < last) && (*begin != '#')) {
+      index.push_back(Entry{size_t(begin - data), uint32_t(last - begin),
+                            line});
+    }
+
+    p = (eol + 1);
+  }
+}
+
+//-----------------------------------------------------------------------------
+std::string EpdFile::getFEN(const std::string_view& epd) {
+  std::istringstream is{std::string(epd)};
+  std::string fen;
+  std::string token;
+  for (int i = 0; (i < 6) && (is >> token); ++i) {
+    if ((i >= 4) && (token.find_first_not_of("0123456789") != token.npos)) {
+      break;
+    }
+    if (i) {
+      fen += ' ';
+    }
+    fen += token;
+  }
+  return fen;
+}
+
+} // namespace senjo
@@ -0,0 +1,99 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2019 Shawn Chidester <zd3nik@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//-----------------------------------------------------------------------------
+
+
+#ifndef SENJO_EPD_FILE_H
+#define SENJO_EPD_FILE_H
+
+#include "MappedFile.h"
+#include <string_view>
+#include <vector>
+
+namespace senjo {
+
+//-----------------------------------------------------------------------------
+//! \brief Read-only, memory mapped EPD file with a record index
+//! The file is mapped into memory and scanned once when opened to build an
+//! index of its records (all lines that aren't blank or comments).  After
+//! that any record can be accessed in constant time, so skipping into the
+//! middle of a large file costs nothing.  Record text refers directly to the
+//! mapped file and remains valid until the file is closed.
+//-----------------------------------------------------------------------------
+class EpdFile {
+public:
+  struct Record {
+    int              line; ///< 1 based line number within the file
+    std::string_view text; ///< Record text, without leading/trailing spaces
+  };
+
+  //--------------------------------------------------------------------------
+  //! \brief Map the given file into memory and index its records
+  //! \param[in] fileName Path to the EPD file
+  //! \return false if the file could not be opened or mapped
+  //--------------------------------------------------------------------------
+  bool open(const std::string& fileName);
+
+  //--------------------------------------------------------------------------
+  //! \brief Unmap the file, all record text is invalid after this call
+  //--------------------------------------------------------------------------
+  void close();
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the number of records in the file
+  //! \return The number of records in the file
+  //--------------------------------------------------------------------------
+  size_t size() const { return index.size(); }
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the record at the given index
+  //! \param[in] i The record index, 0 through size() - 1
+  //! \return The record at index \p i
+  //--------------------------------------------------------------------------
+  Record operator[](const size_t i) const {
+    return Record{index[i].line,
+                  std::string_view((file.data() + index[i].offset),
+                                   index[i].length)};
+  }
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the FEN portion of an EPD record
+  //! \param[in] epd The EPD record
+  //! \return The first 4 fields of \p epd plus the move counters if present
+  //--------------------------------------------------------------------------
+  static std::string getFEN(const std::string_view& epd);
+
+private:
+  struct Entry {
+    size_t   offset;
+    uint32_t length;
+    int      line;
+  };
+
+  void buildIndex();
+
+  MappedFile file;
+  std::vector<Entry> index;
+};
+
+} // namespace senjo
+
+#endif // SENJO_EPD_FILE_H
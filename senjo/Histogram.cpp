@@ -0,0 +1,127 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2019 Shawn Chidester <zd3nik@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//-----------------------------------------------------------------------------
+
+
+#include "Histogram.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace senjo {
+
+//-----------------------------------------------------------------------------
+static inline int msb(const uint64_t value) {
+#if defined(_MSC_VER)
+  unsigned long idx;
+  _BitScanReverse64(&idx, value);
+  return int(idx);
+#else
+  return (63 - __builtin_clzll(value));
+#endif
+}
+
+//-----------------------------------------------------------------------------
+Histogram::Histogram() {
+  clear();
+}
+
+//-----------------------------------------------------------------------------
+void Histogram::clear() {
+  memset(buckets, 0, sizeof(buckets));
+  total = 0;
+  sum = 0;
+  minValue = 0;
+  maxValue = 0;
+}
+
+//-----------------------------------------------------------------------------
+void Histogram::add(const uint64_t value) {
+  buckets[bucketOf(value)]++;
+  if (!total || (value < minValue)) {
+    minValue = value;
+  }
+  if (value > maxValue) {
+    maxValue = value;
+  }
+  sum += value;
+  total++;
+}
+
+//-----------------------------------------------------------------------------
+uint64_t Histogram::percentile(const double pct) const {
+  if (!total) {
+    return 0;
+  }
+
+  uint64_t rank = static_cast<uint64_t>(ceil((pct / 100) * total));
+  rank = std::min<uint64_t>(std::max<uint64_t>(rank, 1), total);
+
+  uint64_t seen = 0;
+  for (int i = 0; i < BUCKETS; ++i) {
+    if ((seen += buckets[i]) >= rank) {
+      return std::max<uint64_t>(std::min(upperBound(i), maxValue), minValue);
+    }
+  }
+  return maxValue;
+}
+
+//-----------------------------------------------------------------------------
+std::string Histogram::summary() const {
+  std::stringstream ss;
+  ss << percentile(50) << " p50, " << percentile(90) << " p90, "
+     << percentile(99) << " p99, " << maximum() << " max";
+  return ss.str();
+}
+
+//-----------------------------------------------------------------------------
+//! \brief Get the bucket index for the given value
+//! Values below SUB_COUNT get their own bucket.  Above that the top SUB_BITS
+//! bits below the most significant bit select one of SUB_COUNT buckets for
+//! each power of two.
+//-----------------------------------------------------------------------------
+int Histogram::bucketOf(const uint64_t value) {
+  if (value < uint64_t(SUB_COUNT)) {
+    return int(value);
+  }
+  const int shift = (msb(value) - SUB_BITS);
+  return (((shift + 1) * SUB_COUNT) + int((value >> shift) & (SUB_COUNT - 1)));
+}
+
+//-----------------------------------------------------------------------------
+//! \brief Get the largest value that maps to the given bucket
+//-----------------------------------------------------------------------------
+uint64_t Histogram::upperBound(const int bucket) {
+  if (bucket < SUB_COUNT) {
+    return uint64_t(bucket);
+  }
+  const int shift = ((bucket / SUB_COUNT) - 1);
+  const uint64_t lower =
+      (uint64_t(SUB_COUNT + (bucket % SUB_COUNT)) << shift);
+  return (lower + ((1ULL << shift) - 1));
+}
+
+} // namespace senjo
@@ -0,0 +1,109 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2019 Shawn Chidester <zd3nik@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//-----------------------------------------------------------------------------
+
+
+#ifndef SENJO_HISTOGRAM_H
+#define SENJO_HISTOGRAM_H
+
+#include "Platform.h"
+#include <string>
+
+namespace senjo {
+
+//-----------------------------------------------------------------------------
+//! \brief Fixed size histogram of unsigned values for percentile reporting
+//! Values below 16 are counted exactly.  Larger values are counted in 16
+//! buckets per power of two, so percentiles are accurate to within 1/16th
+//! (6.25%) of the true value.  Adding a value is constant time and never
+//! allocates memory.
+//-----------------------------------------------------------------------------
+class Histogram {
+public:
+  Histogram();
+
+  //--------------------------------------------------------------------------
+  //! \brief Remove all values from the histogram
+  //--------------------------------------------------------------------------
+  void clear();
+
+  //--------------------------------------------------------------------------
+  //! \brief Add a value to the histogram
+  //! \param[in] value The value to add
+  //--------------------------------------------------------------------------
+  void add(const uint64_t value);
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the number of values added to the histogram
+  //! \return The number of values added to the histogram
+  //--------------------------------------------------------------------------
+  uint64_t count() const { return total; }
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the smallest value added to the histogram
+  //! \return The smallest value, 0 if the histogram is empty
+  //--------------------------------------------------------------------------
+  uint64_t minimum() const { return total ? minValue : 0; }
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the largest value added to the histogram
+  //! \return The largest value, 0 if the histogram is empty
+  //--------------------------------------------------------------------------
+  uint64_t maximum() const { return maxValue; }
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the average of all values added to the histogram
+  //! \return The average value, 0 if the histogram is empty
+  //--------------------------------------------------------------------------
+  double mean() const { return average(double(sum), double(total)); }
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the nearest-rank percentile of the values in the histogram
+  //! \param[in] pct The percentile, 0 through 100
+  //! \return The upper bound of the bucket containing the given percentile,
+  //!         limited to maximum(), or 0 if the histogram is empty
+  //--------------------------------------------------------------------------
+  uint64_t percentile(const double pct) const;
+
+  //--------------------------------------------------------------------------
+  //! \brief Get a "p50, p90, p99, max" summary of the histogram
+  //! \return Summary string, e.g. "12 p50, 40 p90, 97 p99, 120 max"
+  //--------------------------------------------------------------------------
+  std::string summary() const;
+
+private:
+  static const int SUB_BITS = 4;
+  static const int SUB_COUNT = (1 << SUB_BITS);
+  static const int BUCKETS = ((64 - SUB_BITS + 1) * SUB_COUNT);
+
+  static int bucketOf(const uint64_t value);
+  static uint64_t upperBound(const int bucket);
+
+  uint64_t buckets[BUCKETS];
+  uint64_t total;
+  uint64_t sum;
+  uint64_t minValue;
+  uint64_t maxValue;
+};
+
+} // namespace senjo
+
+#endif // SENJO_HISTOGRAM_H
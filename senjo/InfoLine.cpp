@@ -0,0 +1,166 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2019 Shawn Chidester <zd3nik@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//-----------------------------------------------------------------------------
+
+
+#include "InfoLine.h"
+
+namespace senjo {
+
+//-----------------------------------------------------------------------------
+void InfoLine::clear() {
+  fields = 0;
+  depth = 0;
+  seldepth = 0;
+  multipv = 0;
+  score = 0;
+  bound = Exact;
+  nodes = 0;
+  nps = 0;
+  hashfull = 0;
+  tbhits = 0;
+  msecs = 0;
+  currmoveNumber = 0;
+  currmove.clear();
+  pv.clear();
+}
+
+//-----------------------------------------------------------------------------
+InfoLine& InfoLine::setStats(const SearchStats& stats) {
+  setDepth(stats.depth);
+  setSelDepth(stats.seldepth);
+  setNodes(stats.nodes);
+  setTime(stats.msecs);
+  setNps(stats.nps());
+  return *this;
+}
+
+//-----------------------------------------------------------------------------
+InfoLine& InfoLine::setScore(const int cp, const Bound scoreBound) {
+  fields = ((fields & ~ScoreMate) | ScoreCp);
+  score = cp;
+  bound = scoreBound;
+  return *this;
+}
+
+//-----------------------------------------------------------------------------
+InfoLine& InfoLine::setMate(const int moves, const Bound scoreBound) {
+  fields = ((fields & ~ScoreCp) | ScoreMate);
+  score = moves;
+  bound = scoreBound;
+  return *this;
+}
+
+//-----------------------------------------------------------------------------
+InfoLine& InfoLine::setCurrMove(const std::string_view move,
+                                const int number)
+{
+  fields |= CurrMove;
+  currmove.clear();
+  currmove << move;
+  currmoveNumber = number;
+  return *this;
+}
+
+//-----------------------------------------------------------------------------
+InfoLine& InfoLine::setCurrMove(const ChessMove& move, const int number) {
+  fields |= CurrMove;
+  currmove.clear();
+  currmove << move;
+  currmoveNumber = number;
+  return *this;
+}
+
+//-----------------------------------------------------------------------------
+InfoLine& InfoLine::addPv(const std::string_view move) {
+  fields |= Pv;
+  pv << ' ' << move;
+  return *this;
+}
+
+//-----------------------------------------------------------------------------
+InfoLine& InfoLine::addPv(const ChessMove& move) {
+  fields |= Pv;
+  pv << ' ' << move;
+  return *this;
+}
+
+//-----------------------------------------------------------------------------
+void InfoLine::format(LineFormatter& line) const {
+  line << "info";
+  if (fields & Depth) {
+    line << " depth " << depth;
+  }
+  if (fields & SelDepth) {
+    line << " seldepth " << seldepth;
+  }
+  if (fields & MultiPv) {
+    line << " multipv " << multipv;
+  }
+  if (fields & (ScoreCp | ScoreMate)) {
+    line << ((fields & ScoreCp) ? " score cp " : " score mate ") << score;
+    switch (bound) {
+    case LowerBound:
+      line << " lowerbound";
+      break;
+    case UpperBound:
+      line << " upperbound";
+      break;
+    case Exact:
+      break;
+    }
+  }
+  if (fields & Nodes) {
+    line << " nodes " << nodes;
+  }
+  if (fields & Nps) {
+    line << " nps " << nps;
+  }
+  if (fields & HashFull) {
+    line << " hashfull " << hashfull;
+  }
+  if (fields & TbHits) {
+    line << " tbhits " << tbhits;
+  }
+  if (fields & Time) {
+    line << " time " << msecs;
+  }
+  if (fields & CurrMove) {
+    line << " currmove " << currmove.view();
+    if (currmoveNumber > 0) {
+      line << " currmovenumber " << currmoveNumber;
+    }
+  }
+  if (fields & Pv) {
+    line << " pv" << pv.view();
+  }
+}
+
+//-----------------------------------------------------------------------------
+InfoThrottle::Class InfoLine::getClass(InfoThrottle::Kind& kind) const {
+  if (fields & (ScoreCp | ScoreMate | Pv)) {
+    return InfoThrottle::Search;
+  }
+  kind = (fields & CurrMove) ? InfoThrottle::CurrMove : InfoThrottle::Status;
+  return InfoThrottle::Throttled;
+}
+
+} // namespace senjo
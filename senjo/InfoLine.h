@@ -0,0 +1,209 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2019 Shawn Chidester <zd3nik@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//-----------------------------------------------------------------------------
+
+
+#ifndef SENJO_INFO_LINE_H
+#define SENJO_INFO_LINE_H
+
+#include "InfoThrottle.h"
+#include "LineFormatter.h"
+#include "SearchStats.h"
+
+namespace senjo {
+
+//-----------------------------------------------------------------------------
+//! \brief Typed builder for UCI "info" lines
+//! Set the fields that apply and pass the result to ChessEngine::reportInfo()
+//! or Output::write().  Fields are always written in the same order, pv
+//! last, and the line is formatted into a LineFormatter on the stack, so no
+//! memory is allocated.
+//!
+//! Example:
+//!
+//!   InfoLine info;
+//!   info.setStats(stats).setScore(score).setHashFull(hashfull);
+//!   for (int i = 0; i < pvLength; ++i) {
+//!     info.addPv(pv[i]);
+//!   }
+//!   reportInfo(info);
+//!
+//! Because the adapter knows which fields are set it can throttle, log, or
+//! reformat info lines without parsing text.
+//-----------------------------------------------------------------------------
+class InfoLine {
+public:
+  enum Bound {
+    Exact,      ///< The score is exact
+    LowerBound, ///< The score is a lower bound (fail high)
+    UpperBound  ///< The score is an upper bound (fail low)
+  };
+
+  enum Field {
+    Depth      = 0x0001,
+    SelDepth   = 0x0002,
+    MultiPv    = 0x0004,
+    ScoreCp    = 0x0008,
+    ScoreMate  = 0x0010,
+    Nodes      = 0x0020,
+    Nps        = 0x0040,
+    HashFull   = 0x0080,
+    TbHits     = 0x0100,
+    Time       = 0x0200,
+    CurrMove   = 0x0400,
+    Pv         = 0x0800
+  };
+
+  InfoLine() { clear(); }
+
+  //--------------------------------------------------------------------------
+  //! \brief Unset all fields
+  //--------------------------------------------------------------------------
+  void clear();
+
+  //--------------------------------------------------------------------------
+  //! \brief Is the given field set?
+  //! \param[in] field The field to check
+  //! \return true if \p field has been set
+  //--------------------------------------------------------------------------
+  bool has(const Field field) const { return (fields & field); }
+
+  //--------------------------------------------------------------------------
+  //! \brief Is any field set?
+  //! \return true if no fields are set
+  //--------------------------------------------------------------------------
+  bool empty() const { return !fields; }
+
+  //--------------------------------------------------------------------------
+  //! \brief Set depth, seldepth, nodes, time, and nps from \p stats
+  //! \param[in] stats Current search statistics
+  //! \return Reference to self
+  //--------------------------------------------------------------------------
+  InfoLine& setStats(const SearchStats& stats);
+
+  InfoLine& setDepth(const int x)       { return set(Depth, depth, x); }
+  InfoLine& setSelDepth(const int x)    { return set(SelDepth, seldepth, x); }
+  InfoLine& setMultiPv(const int x)     { return set(MultiPv, multipv, x); }
+  InfoLine& setNodes(const uint64_t x)  { return set(Nodes, nodes, x); }
+  InfoLine& setNps(const uint64_t x)    { return set(Nps, nps, x); }
+  InfoLine& setTbHits(const uint64_t x) { return set(TbHits, tbhits, x); }
+  InfoLine& setTime(const uint64_t x)   { return set(Time, msecs, x); }
+
+  //--------------------------------------------------------------------------
+  //! \brief Set the hash table fill rate
+  //! \param[in] permill How full the hash table is, in permill (0 to 1000)
+  //! \return Reference to self
+  //--------------------------------------------------------------------------
+  InfoLine& setHashFull(const int permill) {
+    return set(HashFull, hashfull, permill);
+  }
+
+  //--------------------------------------------------------------------------
+  //! \brief Set the score in centipawns, replaces any mate score
+  //! \param[in] cp The score in centipawns from the engine's point of view
+  //! \param[in] bound Whether \p cp is exact, a lower bound, or upper bound
+  //! \return Reference to self
+  //--------------------------------------------------------------------------
+  InfoLine& setScore(const int cp, const Bound bound = Exact);
+
+  //--------------------------------------------------------------------------
+  //! \brief Set a mate score, replaces any centipawn score
+  //! \param[in] moves Moves (not plies) until mate, negative if the engine
+  //!                  is getting mated
+  //! \param[in] bound Whether \p moves is exact, a lower bound, or upper bound
+  //! \return Reference to self
+  //--------------------------------------------------------------------------
+  InfoLine& setMate(const int moves, const Bound bound = Exact);
+
+  //--------------------------------------------------------------------------
+  //! \brief Set the move currently being searched
+  //! \param[in] move The move in coordinate notation
+  //! \param[in] number The move's number in the move list (first is 1),
+  //!                   0 to omit currmovenumber
+  //! \return Reference to self
+  //--------------------------------------------------------------------------
+  InfoLine& setCurrMove(const std::string_view move, const int number = 0);
+  InfoLine& setCurrMove(const ChessMove& move, const int number = 0);
+
+  //--------------------------------------------------------------------------
+  //! \brief Append a move to the principal variation
+  //! \param[in] move The move in coordinate notation
+  //! \return Reference to self
+  //--------------------------------------------------------------------------
+  InfoLine& addPv(const std::string_view move);
+  InfoLine& addPv(const ChessMove& move);
+
+  //--------------------------------------------------------------------------
+  //! \brief Format the line, starting with "info"
+  //! \param[out] line The formatter to append the line to
+  //--------------------------------------------------------------------------
+  void format(LineFormatter& line) const;
+
+  //--------------------------------------------------------------------------
+  //! \brief Determine how InfoThrottle should treat this line
+  //! \param[out] kind Set to the line kind when Throttled is returned
+  //! \return InfoThrottle::Search if a score or pv is set,
+  //!         otherwise InfoThrottle::Throttled
+  //--------------------------------------------------------------------------
+  InfoThrottle::Class getClass(InfoThrottle::Kind& kind) const;
+
+  // field values, only meaningful when the field is set
+  int getDepth() const                 { return depth; }
+  int getSelDepth() const              { return seldepth; }
+  int getMultiPv() const               { return multipv; }
+  int getScore() const                 { return score; }
+  Bound getBound() const               { return bound; }
+  uint64_t getNodes() const            { return nodes; }
+  uint64_t getNps() const              { return nps; }
+  int getHashFull() const              { return hashfull; }
+  uint64_t getTbHits() const           { return tbhits; }
+  uint64_t getTime() const             { return msecs; }
+  int getCurrMoveNumber() const        { return currmoveNumber; }
+  std::string_view getCurrMove() const { return currmove.view(); }
+  std::string_view getPv() const       { return pv.view(); }
+
+private:
+  template<typename T>
+  InfoLine& set(const Field field, T& member, const T value) {
+    fields |= field;
+    member = value;
+    return *this;
+  }
+
+  unsigned      fields;
+  int           depth;
+  int           seldepth;
+  int           multipv;
+  int           score;   // centipawns or moves to mate
+  Bound         bound;
+  uint64_t      nodes;
+  uint64_t      nps;
+  int           hashfull;
+  uint64_t      tbhits;
+  uint64_t      msecs;
+  int           currmoveNumber;
+  LineFormatter currmove;
+  LineFormatter pv;
+};
+
+} // namespace senjo
+
+#endif // SENJO_INFO_LINE_H
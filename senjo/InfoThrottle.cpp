@@ -0,0 +1,184 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2019 Shawn Chidester <zd3nik@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//-----------------------------------------------------------------------------
+
+
+#include "InfoThrottle.h"
+#include <string_view>
+
+namespace senjo {
+
+//-----------------------------------------------------------------------------
+InfoThrottle::InfoThrottle()
+  : interval(0)
+{
+  for (int i = 0; i < KindCount; ++i) {
+    lastWrite[i] = TimePoint();
+  }
+}
+
+//-----------------------------------------------------------------------------
+std::string InfoThrottle::getKindName(const Kind kind) {
+  switch (kind) {
+  case CurrMove: return "currmove";
+  case CurrLine: return "currline";
+  case Status:   return "status";
+  default:
+    break;
+  }
+  return "unknown";
+}
+
+//-----------------------------------------------------------------------------
+//! \brief Determine what sort of line \p text is
+//! \param[in] text The complete output text, including its trailing '\n'
+//! \param[out] kind Set to the line kind when Throttled is returned
+//! \return The class of line \p text contains
+//-----------------------------------------------------------------------------
+InfoThrottle::Class InfoThrottle::classify(const std::string& text,
+                                           Kind& kind)
+{
+  // never hold back output containing more than one line
+  const size_t end = text.find('\n');
+  if ((end + 1) != text.size()) {
+    return Other;
+  }
+
+  const std::string_view line(text.data(), end);
+  if (line.substr(0, 8) == "bestmove") {
+    return BestMove;
+  }
+  if (line.substr(0, 5) != "info ") {
+    return Other;
+  }
+
+  kind = Status;
+  size_t pos = 5;
+  while (pos < line.size()) {
+    size_t stop = line.find(' ', pos);
+    if (stop == std::string_view::npos) {
+      stop = line.size();
+    }
+    const std::string_view word = line.substr(pos, (stop - pos));
+    if ((word == "pv") || (word == "score") ||
+        (word == "lowerbound") || (word == "upperbound"))
+    {
+      return Search;
+    }
+    if ((word == "string") || (word == "refutation")) {
+      return Other;
+    }
+    if (word == "currline") {
+      kind = CurrLine;
+      break; // the rest of the line is moves
+    }
+    if (word == "currmove") {
+      kind = CurrMove;
+    }
+    pos = (stop + 1);
+  }
+  return Throttled;
+}
+
+//-----------------------------------------------------------------------------
+void InfoThrottle::filter(std::string& text) {
+  Kind kind = Status;
+  const Class cls = classify(text, kind);
+  filter(text, cls, kind);
+}
+
+//-----------------------------------------------------------------------------
+void InfoThrottle::filter(std::string& text, const Class cls, const Kind kind)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  const TimePoint time = now();
+  const uint64_t msecs = interval;
+
+  // write held back lines whose interval has passed ahead of this line,
+  // unless this line supersedes them.  the final status line of a search
+  // (nodes, nps, time) always goes out ahead of bestmove, but a currmove or
+  // currline line is stale by then.
+  released.clear();
+  for (int i = 0; i < KindCount; ++i) {
+    if (pending[i].empty()) {
+      continue;
+    }
+    if (((cls == Throttled) && (i == kind)) ||
+        ((cls == Search) && (i == Status)) ||
+        ((cls == BestMove) && (i != Status)))
+    {
+      counters.suppressed[i]++;
+      pending[i].clear();
+    }
+    else if ((getMsecs(lastWrite[i], time) >= msecs) || (cls == BestMove)) {
+      counters.written[i]++;
+      lastWrite[i] = time;
+      released += pending[i];
+      pending[i].clear();
+    }
+  }
+
+  if (cls == Throttled) {
+    if (getMsecs(lastWrite[kind], time) >= msecs) {
+      counters.written[kind]++;
+      lastWrite[kind] = time;
+    }
+    else {
+      // swap so the held back line keeps its own buffer
+      pending[kind].swap(text);
+      text.clear();
+    }
+  }
+
+  if (!released.empty()) {
+    released += text;
+    text.swap(released);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void InfoThrottle::release(std::string& text) {
+  std::lock_guard<std::mutex> lock(mutex);
+  const TimePoint time = now();
+  text.clear();
+  for (int i = 0; i < KindCount; ++i) {
+    if (!pending[i].empty()) {
+      counters.written[i]++;
+      lastWrite[i] = time;
+      text += pending[i];
+      pending[i].clear();
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+InfoThrottle::Counters InfoThrottle::getCounters() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return counters;
+}
+
+//-----------------------------------------------------------------------------
+void InfoThrottle::resetCounters() {
+  std::lock_guard<std::mutex> lock(mutex);
+  counters = Counters();
+}
+
+} // namespace senjo
@@ -0,0 +1,136 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2019 Shawn Chidester <zd3nik@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//-----------------------------------------------------------------------------
+
+
+#ifndef SENJO_INFO_THROTTLE_H
+#define SENJO_INFO_THROTTLE_H
+
+#include "Platform.h"
+#include <atomic>
+#include <mutex>
+#include <string>
+
+namespace senjo {
+
+//-----------------------------------------------------------------------------
+//! \brief Coalesce high frequency UCI "info" lines
+//! Lines are classified by the first line of their text.  "currmove",
+//! "currline", and plain status lines (nodes, nps, hashfull, etc) are written
+//! at most once per interval for each kind.  A line that arrives too soon is
+//! held back, replacing any line of the same kind already held back, and is
+//! written ahead of the next line once its interval has passed.  Lines with a
+//! "pv", "score", or bound, "info string" lines, "bestmove", and everything
+//! else are always written immediately.  A "pv" or "score" line discards any
+//! held back status line.  "bestmove" writes a held back status line ahead
+//! of itself and discards held back currmove and currline lines.
+//-----------------------------------------------------------------------------
+class InfoThrottle {
+public:
+  enum Kind {
+    CurrMove,   ///< "info ... currmove ..."
+    CurrLine,   ///< "info ... currline ..."
+    Status,     ///< any other "info" line without pv, score, or bound
+    KindCount
+  };
+
+  enum Class {
+    Throttled,  ///< one of the coalesced kinds
+    Search,     ///< "info" line with pv, score, or bound
+    BestMove,   ///< "bestmove" line
+    Other       ///< anything else
+  };
+
+  struct Counters {
+    uint64_t written[KindCount] = {};    ///< lines written, per kind
+    uint64_t suppressed[KindCount] = {}; ///< lines superseded, per kind
+  };
+
+  InfoThrottle();
+
+  //--------------------------------------------------------------------------
+  //! \brief Set the minimum interval between lines of the same kind
+  //! \param[in] msecs The interval in milliseconds, 0 disables throttling
+  //--------------------------------------------------------------------------
+  void setInterval(const uint64_t msecs) { interval = msecs; }
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the minimum interval between lines of the same kind
+  //! \return The interval in milliseconds, 0 if throttling is disabled
+  //--------------------------------------------------------------------------
+  uint64_t getInterval() const { return interval; }
+
+  //--------------------------------------------------------------------------
+  //! \brief Decide what to write in place of the given output text
+  //! \param[in,out] text Complete output text, including its trailing '\n'.
+  //!                     Replaced with the text that should be written now,
+  //!                     which may be empty.
+  //--------------------------------------------------------------------------
+  void filter(std::string& text);
+
+  //--------------------------------------------------------------------------
+  //! \brief Remove all held back lines
+  //! \param[out] text Receives the held back lines, in no particular order
+  //--------------------------------------------------------------------------
+  void release(std::string& text);
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the number of lines written and suppressed so far
+  //! \return Copy of the current counters
+  //--------------------------------------------------------------------------
+  Counters getCounters();
+
+  //--------------------------------------------------------------------------
+  //! \brief Reset all counters to zero
+  //--------------------------------------------------------------------------
+  void resetCounters();
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the name of the given line kind
+  //! \param[in] kind The line kind
+  //! \return The name of \p kind, e.g. "currmove"
+  //--------------------------------------------------------------------------
+  static std::string getKindName(const Kind kind);
+
+  //--------------------------------------------------------------------------
+  //! \brief Same as filter(text) for text that has already been classified
+  //! \param[in,out] text Complete output text, including its trailing '\n'.
+  //!                     Replaced with the text that should be written now,
+  //!                     which may be empty.
+  //! \param[in] cls What sort of line \p text contains
+  //! \param[in] kind The line kind, only used when \p cls is Throttled
+  //--------------------------------------------------------------------------
+  void filter(std::string& text, const Class cls, const Kind kind);
+
+private:
+  static Class classify(const std::string& text, Kind& kind);
+
+  std::atomic<uint64_t> interval;
+  std::mutex mutex;
+  Counters counters;
+  TimePoint lastWrite[KindCount];
+  std::string pending[KindCount];
+  std::string released;
+};
+
+} // namespace senjo
+
+#endif // SENJO_INFO_THROTTLE_H
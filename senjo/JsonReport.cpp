@@ -0,0 +1,143 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2019 Shawn Chidester <zd3nik@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//-----------------------------------------------------------------------------
+
+
+#include "JsonReport.h"
+#include "Output.h"
+#include <cstdio>
+
+namespace senjo {
+
+//-----------------------------------------------------------------------------
+JsonRecord& JsonRecord::add(const char* name, const std::string& value) {
+  addName(name);
+  addString(value.c_str(), value.size());
+  return *this;
+}
+
+//-----------------------------------------------------------------------------
+JsonRecord& JsonRecord::add(const char* name, const char* value) {
+  addName(name);
+  addString(value, strlen(value));
+  return *this;
+}
+
+//-----------------------------------------------------------------------------
+JsonRecord& JsonRecord::add(const char* name, const bool value) {
+  addName(name);
+  text += (value ? "true" : "false");
+  return *this;
+}
+
+//-----------------------------------------------------------------------------
+JsonRecord& JsonRecord::add(const char* name, const int value) {
+  addName(name);
+  text += std::to_string(value);
+  return *this;
+}
+
+//-----------------------------------------------------------------------------
+JsonRecord& JsonRecord::add(const char* name, const uint64_t value) {
+  addName(name);
+  text += std::to_string(value);
+  return *this;
+}
+
+//-----------------------------------------------------------------------------
+JsonRecord& JsonRecord::add(const char* name, const double value) {
+  addName(name);
+  char str[32];
+  snprintf(str, sizeof(str), "%.3f", value);
+  text += str;
+  return *this;
+}
+
+//-----------------------------------------------------------------------------
+void JsonRecord::addName(const char* name) {
+  if (text.size() > 1) {
+    text += ',';
+  }
+  addString(name, strlen(name));
+  text += ':';
+}
+
+//-----------------------------------------------------------------------------
+void JsonRecord::addString(const char* str, const size_t len) {
+  text += '"';
+  for (size_t i = 0; i < len; ++i) {
+    const char ch = str[i];
+    switch (ch) {
+    case '"':  text += "\\\""; break;
+    case '\\': text += "\\\\"; break;
+    case '\n': text += "\\n";  break;
+    case '\r': text += "\\r";  break;
+    case '\t': text += "\\t";  break;
+    default:
+      if (static_cast<unsigned char>(ch) < 0x20) {
+        char hex[8];
+        snprintf(hex, sizeof(hex), "\\u%04x", static_cast<unsigned>(ch));
+        text += hex;
+      }
+      else {
+        text += ch;
+      }
+    }
+  }
+  text += '"';
+}
+
+//-----------------------------------------------------------------------------
+bool JsonReport::open(const std::string& fileName) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (out.is_open()) {
+    out.close();
+  }
+
+  // must be set before the file is opened to take effect on all platforms
+  out.rdbuf()->pubsetbuf(buffer, _BUFFER_SIZE);
+  out.open(fileName, std::ios::out | std::ios::trunc);
+  if (!out) {
+    Output() << "Cannot open report file: " << fileName;
+    return false;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void JsonReport::close() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (out.is_open()) {
+    out.close();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void JsonReport::write(const JsonRecord& record) {
+  const std::string text = record.str();
+  std::lock_guard<std::mutex> lock(mutex);
+  if (out.is_open()) {
+    out.write(text.data(), std::streamsize(text.size()));
+    out.put('\n');
+  }
+}
+
+} // namespace senjo
@@ -0,0 +1,111 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2019 Shawn Chidester <zd3nik@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//-----------------------------------------------------------------------------
+
+
+#ifndef SENJO_JSON_REPORT_H
+#define SENJO_JSON_REPORT_H
+
+#include "Platform.h"
+#include <fstream>
+#include <mutex>
+
+namespace senjo {
+
+//-----------------------------------------------------------------------------
+//! \brief A single JSON object, built one member at a time
+//! Example:
+//!
+//!   JsonRecord record;
+//!   record.add("type", "perft").add("depth", 5).add("passed", true);
+//!
+//! Produces: {"type":"perft","depth":5,"passed":true}
+//-----------------------------------------------------------------------------
+class JsonRecord {
+public:
+  JsonRecord() : text("{") { }
+
+  JsonRecord& add(const char* name, const std::string& value);
+  JsonRecord& add(const char* name, const char* value);
+  JsonRecord& add(const char* name, const bool value);
+  JsonRecord& add(const char* name, const int value);
+  JsonRecord& add(const char* name, const uint64_t value);
+  JsonRecord& add(const char* name, const double value);
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the JSON text of this record
+  //! \return The JSON text of this record, without a trailing new-line
+  //--------------------------------------------------------------------------
+  std::string str() const { return (text + '}'); }
+
+private:
+  void addName(const char* name);
+  void addString(const char* str, const size_t len);
+
+  std::string text;
+};
+
+//-----------------------------------------------------------------------------
+//! \brief Buffered writer for JSON Lines (one JSON object per line) files
+//! Records are written through a large stream buffer so writing one record
+//! per position doesn't slow down long test runs.  The buffer is flushed when
+//! it fills up and when the report is closed.  It is safe to call write()
+//! from multiple threads.
+//-----------------------------------------------------------------------------
+class JsonReport {
+public:
+  ~JsonReport() { close(); }
+
+  //--------------------------------------------------------------------------
+  //! \brief Create (or truncate) the given report file
+  //! \param[in] fileName Path to the report file
+  //! \return false if the file could not be opened for writing
+  //--------------------------------------------------------------------------
+  bool open(const std::string& fileName);
+
+  //--------------------------------------------------------------------------
+  //! \brief Flush and close the report file
+  //--------------------------------------------------------------------------
+  void close();
+
+  //--------------------------------------------------------------------------
+  //! \brief Is the report file open?
+  //! \return true if open() succeeded and close() has not been called
+  //--------------------------------------------------------------------------
+  bool isOpen() const { return out.is_open(); }
+
+  //--------------------------------------------------------------------------
+  //! \brief Append a record to the report
+  //! \param[in] record The record to append, ignored if the report isn't open
+  //--------------------------------------------------------------------------
+  void write(const JsonRecord& record);
+
+private:
+  static const size_t _BUFFER_SIZE = 65536;
+
+  std::ofstream out;
+  std::mutex mutex;
+  char buffer[_BUFFER_SIZE];
+};
+
+} // namespace senjo
+
+#endif // SENJO_JSON_REPORT_H
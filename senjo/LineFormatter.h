@@ -0,0 +1,181 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2019 Shawn Chidester <zd3nik@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//-----------------------------------------------------------------------------
+
+
+#ifndef SENJO_LINE_FORMATTER_H
+#define SENJO_LINE_FORMATTER_H
+
+#include "ChessMove.h"
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace senjo {
+
+//-----------------------------------------------------------------------------
+//! \brief Fixed capacity line formatter that never allocates memory
+//! Integers are formatted with std::to_chars, strings and moves are copied
+//! directly into a buffer held within the object, so a LineFormatter on the
+//! stack can build a complete UCI line without touching the heap or any
+//! stream locks.  Pass the result to Output::write().
+//!
+//! Example:
+//!
+//!   LineFormatter line;
+//!   line << "info " << stats << " score cp " << score << " pv";
+//!   for (int i = 0; i < pvLength; ++i) {
+//!     line << ' ' << pv[i];
+//!   }
+//!   Output::write(line.view(), Output::NoPrefix);
+//!
+//! Anything that doesn't fit within CAPACITY characters is dropped and
+//! truncated() returns true.
+//-----------------------------------------------------------------------------
+class LineFormatter {
+public:
+  static const size_t CAPACITY = 1024;
+
+  LineFormatter() : length(0), overflow(false) { }
+
+  //--------------------------------------------------------------------------
+  //! \brief Remove all text from the formatter
+  //--------------------------------------------------------------------------
+  void clear() {
+    length = 0;
+    overflow = false;
+  }
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the formatted text
+  //! \return View of the formatted text, valid until the formatter changes
+  //--------------------------------------------------------------------------
+  std::string_view view() const { return std::string_view(buffer, length); }
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the formatted text as a string (allocates memory)
+  //! \return Copy of the formatted text
+  //--------------------------------------------------------------------------
+  std::string toString() const { return std::string(buffer, length); }
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the number of characters formatted so far
+  //! \return The number of characters in the formatter
+  //--------------------------------------------------------------------------
+  size_t size() const { return length; }
+
+  //--------------------------------------------------------------------------
+  //! \brief Is the formatter empty?
+  //! \return true if no characters have been formatted
+  //--------------------------------------------------------------------------
+  bool empty() const { return !length; }
+
+  //--------------------------------------------------------------------------
+  //! \brief Has any text been dropped because the formatter was full?
+  //! \return true if text has been dropped since construction or clear()
+  //--------------------------------------------------------------------------
+  bool truncated() const { return overflow; }
+
+  LineFormatter& operator<<(const char ch) {
+    if (length < CAPACITY) {
+      buffer[length++] = ch;
+    }
+    else {
+      overflow = true;
+    }
+    return *this;
+  }
+
+  LineFormatter& operator<<(const std::string_view str) {
+    size_t count = str.size();
+    if (count > (CAPACITY - length)) {
+      count = (CAPACITY - length);
+      overflow = true;
+    }
+    memcpy(buffer + length, str.data(), count);
+    length += count;
+    return *this;
+  }
+
+  LineFormatter& operator<<(const char* str) {
+    return (*this << std::string_view(str));
+  }
+
+  LineFormatter& operator<<(const std::string& str) {
+    return (*this << std::string_view(str));
+  }
+
+  LineFormatter& operator<<(const bool value) {
+    return (*this << (value ? '1' : '0'));
+  }
+
+  template<typename T,
+           typename = std::enable_if_t<std::is_integral<T>::value>>
+  LineFormatter& operator<<(const T value) {
+    const std::to_chars_result result =
+        std::to_chars(buffer + length, buffer + CAPACITY, value);
+    if (result.ec == std::errc()) {
+      length = size_t(result.ptr - buffer);
+    }
+    else {
+      overflow = true;
+    }
+    return *this;
+  }
+
+  LineFormatter& operator<<(const Square& square) {
+    if (square.isValid()) {
+      *this << static_cast<char>('a' + square.x())
+            << static_cast<char>('1' + square.y());
+    }
+    return *this;
+  }
+
+  LineFormatter& operator<<(const ChessMove& move) {
+    if (move.from.isValid() && move.to.isValid() && (move.from != move.to)) {
+      *this << move.from << move.to;
+      if (move.promo) {
+        *this << static_cast<char>(tolower(move.promo));
+      }
+    }
+    return *this;
+  }
+
+private:
+  size_t length;
+  bool overflow;
+  char buffer[CAPACITY];
+};
+
+//-----------------------------------------------------------------------------
+inline std::ostream& operator<<(std::ostream& os, const LineFormatter& line) {
+  const std::string_view text = line.view();
+  os.write(text.data(), std::streamsize(text.size()));
+  return os;
+}
+
+} // namespace senjo
+
+#endif // SENJO_LINE_FORMATTER_H
@@ -0,0 +1,141 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2019 Shawn Chidester <zd3nik@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//-----------------------------------------------------------------------------
+
+
+#include "MappedFile.h"
+#include "Output.h"
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace senjo {
+
+//-----------------------------------------------------------------------------
+MappedFile::MappedFile()
+  : addr(nullptr),
+    length(0)
+#ifdef WIN32
+    , file(INVALID_HANDLE_VALUE),
+    mapping(nullptr)
+#endif
+{
+}
+
+//-----------------------------------------------------------------------------
+MappedFile::~MappedFile() {
+  close();
+}
+
+//-----------------------------------------------------------------------------
+bool MappedFile::open(const std::string& fileName) {
+  close();
+
+#ifdef WIN32
+  file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                     OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    Output() << "Cannot open " << fileName;
+    return false;
+  }
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size)) {
+    Output() << "Cannot get size of " << fileName;
+    close();
+    return false;
+  }
+
+  length = static_cast<size_t>(size.QuadPart);
+  if (length) {
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping) {
+      addr = static_cast<const char*>(
+          MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    }
+    if (!addr) {
+      Output() << "Cannot map " << fileName;
+      close();
+      return false;
+    }
+  }
+#else
+  const int fd = ::open(fileName.c_str(), O_RDONLY);
+  if (fd < 0) {
+    Output() << "Cannot open " << fileName;
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st)) {
+    Output() << "Cannot get size of " << fileName;
+    ::close(fd);
+    return false;
+  }
+
+  length = static_cast<size_t>(st.st_size);
+  if (length) {
+    void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+      Output() << "Cannot map " << fileName;
+      ::close(fd);
+      length = 0;
+      return false;
+    }
+    madvise(p, length, MADV_SEQUENTIAL);
+    addr = static_cast<const char*>(p);
+  }
+
+  // the mapping remains valid after the file descriptor is closed
+  ::close(fd);
+#endif
+
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void MappedFile::close() {
+#ifdef WIN32
+  if (addr) {
+    UnmapViewOfFile(addr);
+  }
+  if (mapping) {
+    CloseHandle(mapping);
+    mapping = nullptr;
+  }
+  if (file != INVALID_HANDLE_VALUE) {
+    CloseHandle(file);
+    file = INVALID_HANDLE_VALUE;
+  }
+#else
+  if (addr) {
+    munmap(const_cast<char*>(addr), length);
+  }
+#endif
+  addr = nullptr;
+  length = 0;
+}
+
+} // namespace senjo
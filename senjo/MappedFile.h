@@ -0,0 +1,77 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2019 Shawn Chidester <zd3nik@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//-----------------------------------------------------------------------------
+
+
+#ifndef SENJO_MAPPED_FILE_H
+#define SENJO_MAPPED_FILE_H
+
+#include "Platform.h"
+
+namespace senjo {
+
+//-----------------------------------------------------------------------------
+//! \brief A file mapped read-only into memory
+//-----------------------------------------------------------------------------
+class MappedFile {
+public:
+  MappedFile();
+  ~MappedFile();
+
+  //--------------------------------------------------------------------------
+  //! \brief Map the given file into memory
+  //! \param[in] fileName Path to the file
+  //! \return false if the file could not be opened or mapped
+  //--------------------------------------------------------------------------
+  bool open(const std::string& fileName);
+
+  //--------------------------------------------------------------------------
+  //! \brief Unmap the file, all pointers into the file are invalid after this
+  //--------------------------------------------------------------------------
+  void close();
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the file contents
+  //! \return Pointer to the first byte of the file, nullptr if empty
+  //--------------------------------------------------------------------------
+  const char* data() const { return addr; }
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the file size
+  //! \return The number of bytes in the file
+  //--------------------------------------------------------------------------
+  size_t size() const { return length; }
+
+private:
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const char* addr;
+  size_t length;
+#ifdef WIN32
+  HANDLE file;
+  HANDLE mapping;
+#endif
+};
+
+} // namespace senjo
+
+#endif // SENJO_MAPPED_FILE_H
@@ -20,27 +20,151 @@
 // THE SOFTWARE.
 //-----------------------------------------------------------------------------
 
+
 #include "Output.h"
+#include "InfoLine.h"
 
 namespace senjo {
 
 //-----------------------------------------------------------------------------
-// static variables
+//! \brief Stream buffer that appends everything written to a string
 //-----------------------------------------------------------------------------
-std::mutex Output::_mutex;
-TimePoint  Output::_lastOutput = now();
+class LineBuffer : public std::streambuf {
+public:
+  std::string text;
+  bool busy = false;
+
+protected:
+  int_type overflow(int_type ch) {
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+      text.push_back(traits_type::to_char_type(ch));
+    }
+    return traits_type::not_eof(ch);
+  }
+
+  std::streamsize xsputn(const char* str, std::streamsize count) {
+    text.append(str, size_t(count));
+    return count;
+  }
+};
+
+//-----------------------------------------------------------------------------
+// each thread formats output into its own buffers
+//-----------------------------------------------------------------------------
+static thread_local LineBuffer _lineBuffer;
+static thread_local std::ostream _lineStream(&_lineBuffer);
+static thread_local std::string _writeBuffer;
+
+//-----------------------------------------------------------------------------
+static const std::string_view INFO_STRING("info string ");
 
 //-----------------------------------------------------------------------------
 TimePoint Output::lastOutput() {
-  return _lastOutput;
+  return OutputSink::current().lastOutput();
+}
+
+//-----------------------------------------------------------------------------
+void Output::setAsync(const bool enable, const size_t capacity) {
+  OutputSink::current().setAsync(enable, capacity);
+}
+
+//-----------------------------------------------------------------------------
+bool Output::isAsync() {
+  return OutputSink::current().isAsync();
+}
+
+//-----------------------------------------------------------------------------
+void Output::flush() {
+  OutputSink::current().flush();
+}
+
+//-----------------------------------------------------------------------------
+void Output::write(const std::string_view line, const OutputPrefix prefix) {
+  writeLine(((prefix == InfoPrefix) ? INFO_STRING : std::string_view()),
+            line, nullptr);
+}
+
+//-----------------------------------------------------------------------------
+void Output::write(const InfoLine& info) {
+  LineFormatter line;
+  info.format(line);
+  writeLine(std::string_view(), line.view(), &info);
+}
+
+//-----------------------------------------------------------------------------
+//! \brief Write \p start followed by \p line as one line of output
+//! \param[in] start Text to write before \p line, may be empty
+//! \param[in] line The line to write, without a trailing '\n'
+//! \param[in] info The info line \p line was formatted from, if any
+//-----------------------------------------------------------------------------
+void Output::writeLine(const std::string_view start,
+                       const std::string_view line,
+                       const InfoLine* info)
+{
+  OutputSink& sink = OutputSink::current();
+  std::string& text = _writeBuffer;
+  text.assign(start);
+  text.append(line);
+  text.push_back('\n');
+
+  InfoThrottle& throttle = sink.getThrottle();
+  if (throttle.getInterval()) {
+    if (info) {
+      InfoThrottle::Kind kind = InfoThrottle::Status;
+      const InfoThrottle::Class cls = info->getClass(kind);
+      throttle.filter(text, cls, kind);
+    }
+    else {
+      throttle.filter(text);
+    }
+  }
+
+  sink.submit(text);
+}
+
+//-----------------------------------------------------------------------------
+void Output::setInfoInterval(const uint64_t msecs) {
+  OutputSink& sink = OutputSink::current();
+  sink.getThrottle().setInterval(msecs);
+  if (!msecs) {
+    sink.flush();
+  }
+}
+
+//-----------------------------------------------------------------------------
+uint64_t Output::getInfoInterval() {
+  return OutputSink::current().getThrottle().getInterval();
 }
 
 //-----------------------------------------------------------------------------
-Output::Output(const OutputPrefix prefix) {
-  _mutex.lock();
+InfoThrottle::Counters Output::getInfoCounters(const bool reset) {
+  InfoThrottle& throttle = OutputSink::current().getThrottle();
+  InfoThrottle::Counters counters = throttle.getCounters();
+  if (reset) {
+    throttle.resetCounters();
+  }
+  return counters;
+}
+
+//-----------------------------------------------------------------------------
+Output::Output(const OutputPrefix prefix)
+  : sink(OutputSink::current()),
+    stream(&_lineStream),
+    throttled(sink.getThrottle().getInterval() > 0)
+{
+  if (_lineBuffer.busy) {
+    // another Output instance on this thread is using the thread's buffer
+    nested.reset(new std::ostringstream());
+    stream = nested.get();
+  }
+  else {
+    _lineBuffer.busy = true;
+    _lineBuffer.text.clear();
+  }
+
   switch (prefix) {
   case OutputPrefix::InfoPrefix:
-    std::cout << "info string ";
+    *stream << INFO_STRING;
     break;
   case OutputPrefix::NoPrefix:
     break;
@@ -49,10 +173,22 @@ Output::Output(const OutputPrefix prefix) {
 
 //-----------------------------------------------------------------------------
 Output::~Output() {
-  std::cout << '\n';
-  std::cout.flush();
-  _lastOutput = now();
-  _mutex.unlock();
+  *stream << '\n';
+
+  std::string nestedText;
+  std::string& text = nested ? nestedText : _lineBuffer.text;
+  if (nested) {
+    nestedText = nested->str();
+  }
+
+  if (throttled) {
+    sink.getThrottle().filter(text);
+  }
+  sink.submit(text);
+
+  if (!nested) {
+    _lineBuffer.busy = false;
+  }
 }
 
 } // namespace senjo
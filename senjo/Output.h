@@ -24,15 +24,23 @@
 #define SENJO_OUTPUT_H
 
 #include "Platform.h"
+#include "OutputSink.h"
 #include <iostream>
-#include <mutex>
+#include <memory>
+#include <sstream>
+#include <string_view>
 
 namespace senjo {
 
+class InfoLine;
+
 //-----------------------------------------------------------------------------
-//! \brief Thread safe stdout stream
-//! Instantiating this class will obtain a lock on a mtuex guarding stdout.
-//! The stdout mutex is released when the instantiated object is destroyed.
+//! \brief Thread safe output stream
+//! Everything written to an instance of this class is formatted into a buffer
+//! owned by the calling thread, without holding any lock.  When the instance
+//! is destroyed the text is written, in one piece, to the calling thread's
+//! current OutputSink, which is stdout unless a UCIAdapter or OutputSink::Scope
+//! has selected another.
 //!
 //! \e Important: '\n' is automatically appended when the object is destroyed.
 //! \e Important: The UCI protocol requires that lines end with a single
@@ -87,6 +95,23 @@ namespace senjo {
 //! Notice it is necessary to explicitly prefix all but the first line with
 //! "info string ".  If you know what you're doing concerning the UCI protocol
 //! you can omit "info string " where appropriate.
+//!
+//! In asynchronous mode (see setAsync()) the destructor hands the completed
+//! text to a queue that a dedicated writer thread drains to the sink's
+//! destination.  Everything written through one Output instance still appears
+//! together, and output from a thread that happens after an Output instance
+//! is destroyed always appears after it.
+//!
+//! When an info interval is set (see setInfoInterval()) each completed line
+//! is passed through an InfoThrottle before it is written, so high frequency
+//! "currmove", "currline", and status lines are coalesced.  Lines with a pv,
+//! score, or bound, "info string" lines, and "bestmove" are never held back.
+//!
+//! For lines produced at high frequency, such as "info" lines during search,
+//! build the line with a LineFormatter and pass it to write().  This avoids
+//! the std::ostream machinery entirely.
+//!
+//! The static methods below apply to the calling thread's current sink.
 //-----------------------------------------------------------------------------
 class Output {
 public:
@@ -108,11 +133,72 @@ public:
   virtual ~Output();
 
   //--------------------------------------------------------------------------
-  //! \brief Get timestamp of the last time an Output class was destroyed
-  //! \return Timestamp of last Output class destruction, 0 if none
+  //! \brief Get timestamp of the last time output was written
+  //! \return Timestamp of the last output written to the current sink
   //--------------------------------------------------------------------------
   static TimePoint lastOutput();
 
+  //--------------------------------------------------------------------------
+  //! \brief Enable or disable asynchronous output, see OutputSink::setAsync()
+  //! Should only be called while no other threads are producing output,
+  //! e.g. at program start-up.  Disabling writes all queued output first.
+  //! \param[in] enable true to enable asynchronous output
+  //! \param[in] capacity Number of lines that can be queued before output
+  //!                     blocks waiting for the writer thread
+  //--------------------------------------------------------------------------
+  static void setAsync(const bool enable, const size_t capacity = 4096);
+
+  //--------------------------------------------------------------------------
+  //! \brief Is asynchronous output enabled?
+  //! \return true if asynchronous output is enabled
+  //--------------------------------------------------------------------------
+  static bool isAsync();
+
+  //--------------------------------------------------------------------------
+  //! \brief Wait until all output produced so far has been written
+  //--------------------------------------------------------------------------
+  static void flush();
+
+  //--------------------------------------------------------------------------
+  //! \brief Write one complete line of output
+  //! Equivalent to Output(prefix) << line, but without the std::ostream
+  //! machinery.  Does not allocate memory once each thread's buffer has
+  //! warmed up.
+  //! \param[in] line The line to write, without a trailing '\n'
+  //! \param[in] prefix NoPrefix or InfoPrefix (InfoPrefix is the default)
+  //--------------------------------------------------------------------------
+  static void write(const std::string_view line,
+                    const OutputPrefix prefix = InfoPrefix);
+
+  //--------------------------------------------------------------------------
+  //! \brief Write an "info" line
+  //! Same as write(line) but the info line throttle uses the fields set in
+  //! \p info rather than parsing the formatted text.
+  //! \param[in] info The info line to write
+  //--------------------------------------------------------------------------
+  static void write(const InfoLine& info);
+
+  //--------------------------------------------------------------------------
+  //! \brief Set the minimum interval between "info" lines of the same kind
+  //! See InfoThrottle for which lines are coalesced.  Setting the interval
+  //! to 0 disables throttling and writes any held back lines.
+  //! \param[in] msecs The interval in milliseconds, 0 disables throttling
+  //--------------------------------------------------------------------------
+  static void setInfoInterval(const uint64_t msecs);
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the minimum interval between "info" lines of the same kind
+  //! \return The interval in milliseconds, 0 if throttling is disabled
+  //--------------------------------------------------------------------------
+  static uint64_t getInfoInterval();
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the number of "info" lines written and suppressed so far
+  //! \param[in] reset true to reset the counters to zero afterward
+  //! \return Copy of the counters
+  //--------------------------------------------------------------------------
+  static InfoThrottle::Counters getInfoCounters(const bool reset = false);
+
   //--------------------------------------------------------------------------
   //! \brief Insertion operator
   //! All data types supported by std::cout are supported here.
@@ -120,13 +206,19 @@ public:
   //--------------------------------------------------------------------------
   template<typename T>
   Output& operator<<(const T& x) {
-    std::cout << x;
+    *stream << x;
     return *this;
   }
 
 private:
-  static std::mutex _mutex;
-  static TimePoint _lastOutput;
+  static void writeLine(const std::string_view start,
+                        const std::string_view line,
+                        const InfoLine* info);
+
+  OutputSink& sink;
+  std::ostream* stream;
+  std::unique_ptr<std::ostringstream> nested;
+  bool throttled;
 };
 
 } // namespace senjo
@@ -0,0 +1,229 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2019 Shawn Chidester <zd3nik@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//-----------------------------------------------------------------------------
+
+
+#include "OutputQueue.h"
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace senjo {
+
+//-----------------------------------------------------------------------------
+static uint64_t powerOf2(const size_t capacity) {
+  uint64_t size = 2;
+  while (size < capacity) {
+    size <<= 1;
+  }
+  return size;
+}
+
+//-----------------------------------------------------------------------------
+OutputQueue::OutputQueue(const size_t capacity, const Writer& writer)
+  : writer(writer),
+    slots(new Slot[powerOf2(capacity)]),
+    mask(powerOf2(capacity) - 1),
+    head(0),
+    tail(0),
+    stopping(false),
+    waiting(false),
+    wakeups(0),
+    flushing(0)
+{
+  // a slot is free for position N when its sequence is N,
+  // and holds the line for position N when its sequence is N + 1
+  for (uint64_t i = 0; i <= mask; ++i) {
+    slots[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+//-----------------------------------------------------------------------------
+OutputQueue::~OutputQueue() {
+  stop();
+  waitForFinish();
+}
+
+//-----------------------------------------------------------------------------
+void OutputQueue::push(std::string& line) {
+  uint64_t pos = head.load(std::memory_order_relaxed);
+  Slot* slot = nullptr;
+  while (true) {
+    slot = &slots[pos & mask];
+    const uint64_t seq = slot->sequence.load(std::memory_order_acquire);
+    if (seq == pos) {
+      if (head.compare_exchange_weak(pos, (pos + 1),
+                                     std::memory_order_relaxed))
+      {
+        break;
+      }
+    }
+    else if (seq < pos) {
+      // queue is full, the writer hasn't released this slot yet
+      if (waiting.exchange(false)) {
+        wakeWriter();
+      }
+      std::this_thread::yield();
+      pos = head.load(std::memory_order_relaxed);
+    }
+    else {
+      pos = head.load(std::memory_order_relaxed);
+    }
+  }
+
+  slot->text.swap(line);
+  line.clear();
+  slot->sequence.store((pos + 1), std::memory_order_seq_cst);
+
+  // pairs with the seq_cst store to waiting in doWork(),
+  // either the writer sees this line or this thread sees the writer parked,
+  // the plain load keeps the busy writer case free of read-modify-writes
+  // and the exchange makes sure only one producer wakes a parked writer
+  if (waiting.load(std::memory_order_seq_cst) &&
+      waiting.exchange(false, std::memory_order_seq_cst))
+  {
+    wakeWriter();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void OutputQueue::flush() {
+  const uint64_t target = head.load();
+  if (tail.load() >= target) {
+    return;
+  }
+
+  // pairs with the tail store in doWork(), either the writer sees this
+  // thread waiting or this thread sees the lines written
+  flushing.fetch_add(1);
+  {
+    std::unique_lock<std::mutex> lock(signalMutex);
+    while ((tail.load() < target) && isRunning()) {
+      drained.wait_for(lock, std::chrono::milliseconds(10));
+    }
+  }
+  flushing.fetch_sub(1);
+}
+
+//-----------------------------------------------------------------------------
+void OutputQueue::stop() {
+  stopping = true;
+  wakeWriter();
+}
+
+//-----------------------------------------------------------------------------
+void OutputQueue::wakeWriter() {
+  wakeups.fetch_add(1, std::memory_order_seq_cst);
+#ifdef __linux__
+  static_assert(sizeof(wakeups) == sizeof(uint32_t), "futex word size");
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(&wakeups),
+          FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#else
+  { std::lock_guard<std::mutex> lock(signalMutex); }
+  wake.notify_one();
+#endif
+}
+
+//-----------------------------------------------------------------------------
+//! \brief Park the writer thread until wakeups no longer equals \p seen
+//-----------------------------------------------------------------------------
+void OutputQueue::waitForWakeup(const uint32_t seen) {
+#ifdef __linux__
+  while (wakeups.load(std::memory_order_acquire) == seen) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&wakeups),
+            FUTEX_WAIT_PRIVATE, seen, nullptr, nullptr, 0);
+  }
+#else
+  std::unique_lock<std::mutex> lock(signalMutex);
+  while (wakeups.load(std::memory_order_acquire) == seen) {
+    wake.wait(lock);
+  }
+#endif
+}
+
+//-----------------------------------------------------------------------------
+void OutputQueue::doWork() {
+  uint64_t pos = tail.load();
+  while (true) {
+    // collect consecutive completed lines, stopping at the first slot that
+    // has been claimed but not filled yet so order is preserved
+    size_t count = 0;
+    while ((count < MAX_BATCH) &&
+           (slots[(pos + count) & mask].sequence.load(
+               std::memory_order_acquire) == (pos + count + 1)))
+    {
+      count++;
+    }
+
+    if (!count) {
+      if (stopping && (head.load() == pos)) {
+        break;
+      }
+      // read wakeups before announcing the park so a wakeup sent after the
+      // recheck below can't be missed
+      const uint32_t seen = wakeups.load(std::memory_order_seq_cst);
+      waiting.store(true, std::memory_order_seq_cst);
+      if ((slots[pos & mask].sequence.load(std::memory_order_seq_cst) !=
+           (pos + 1)) && !stopping)
+      {
+        waitForWakeup(seen);
+
+        // let the producer that woke us queue more lines before the next
+        // batch, this matters most when both share a single core
+        std::this_thread::yield();
+      }
+      waiting.store(false, std::memory_order_relaxed);
+      continue;
+    }
+
+    write(pos, count);
+
+    // release the slots for reuse, each keeps its string buffer
+    for (size_t i = 0; i < count; ++i) {
+      Slot& slot = slots[(pos + i) & mask];
+      slot.text.clear();
+      slot.sequence.store((pos + i + mask + 1), std::memory_order_release);
+    }
+    pos += count;
+    tail.store(pos);
+
+    if (flushing.load()) {
+      { std::lock_guard<std::mutex> lock(signalMutex); }
+      drained.notify_all();
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+//! \brief Pass \p count lines starting at queue position \p first to writer
+//-----------------------------------------------------------------------------
+void OutputQueue::write(const uint64_t first, const size_t count) {
+  std::string_view lines[MAX_BATCH];
+  for (size_t i = 0; i < count; ++i) {
+    lines[i] = slots[(first + i) & mask].text;
+  }
+  writer(lines, count);
+}
+
+} // namespace senjo
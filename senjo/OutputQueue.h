@@ -0,0 +1,122 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2019 Shawn Chidester <zd3nik@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//-----------------------------------------------------------------------------
+
+
+#ifndef SENJO_OUTPUT_QUEUE_H
+#define SENJO_OUTPUT_QUEUE_H
+
+#include "Thread.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace senjo {
+
+//-----------------------------------------------------------------------------
+//! \brief Lock-free multi-producer, single-consumer queue of output lines
+//! Any number of threads push complete lines, a single writer thread drains
+//! the queue in batches and hands each batch to a writer function.  Lines are
+//! written whole and in the order their push() calls claimed a queue slot,
+//! so a line pushed after another push() returned is always written after it.
+//!
+//! The queue has a fixed number of slots.  Each slot keeps its string buffer
+//! after the line is written, and push() hands that buffer back to the
+//! caller, so steady state output doesn't allocate.  When the queue is full
+//! push() waits for the writer rather than drop lines.
+//-----------------------------------------------------------------------------
+class OutputQueue : public Thread {
+public:
+  //--------------------------------------------------------------------------
+  //! \brief Maximum number of lines passed to the writer function at once
+  //--------------------------------------------------------------------------
+  static const size_t MAX_BATCH = 64;
+
+  //--------------------------------------------------------------------------
+  //! \brief Function that writes \p count lines, called on the writer thread
+  //--------------------------------------------------------------------------
+  typedef std::function<void(const std::string_view* lines,
+                             const size_t count)> Writer;
+
+  //--------------------------------------------------------------------------
+  //! \brief Constructor, the writer thread is started by run()
+  //! \param[in] capacity Number of lines the queue can hold, rounded up to a
+  //!                     power of 2
+  //! \param[in] writer Function that writes each batch of lines
+  //--------------------------------------------------------------------------
+  OutputQueue(const size_t capacity, const Writer& writer);
+
+  //--------------------------------------------------------------------------
+  //! \brief Destructor, writes any queued lines before returning
+  //--------------------------------------------------------------------------
+  ~OutputQueue();
+
+  //--------------------------------------------------------------------------
+  //! \brief Add a line to the end of the queue
+  //! \param[in,out] line The line to add, including its trailing '\n'.
+  //!                     Replaced with an empty string.
+  //--------------------------------------------------------------------------
+  void push(std::string& line);
+
+  //--------------------------------------------------------------------------
+  //! \brief Wait until every line pushed before this call has been written
+  //--------------------------------------------------------------------------
+  void flush();
+
+  //--------------------------------------------------------------------------
+  //! \brief Tell the writer thread to exit once the queue is empty
+  //--------------------------------------------------------------------------
+  void stop();
+
+protected:
+  void doWork();
+
+private:
+  struct Slot {
+    std::atomic<uint64_t> sequence;
+    std::string text;
+  };
+
+  void wakeWriter();
+  void waitForWakeup(const uint32_t seen);
+  void write(const uint64_t first, const size_t count);
+
+  const Writer writer;
+  std::unique_ptr<Slot[]> slots;
+  const uint64_t mask;
+  alignas(64) std::atomic<uint64_t> head;    //!< next slot to claim
+  alignas(64) std::atomic<uint64_t> tail;    //!< next slot to write
+  std::atomic<bool> stopping;
+  std::atomic<bool> waiting;                 //!< writer is parked
+  std::atomic<uint32_t> wakeups;             //!< bumped to unpark writer
+  std::atomic<int> flushing;                 //!< threads waiting in flush()
+  std::mutex signalMutex;
+#ifndef __linux__
+  std::condition_variable wake;
+#endif
+  std::condition_variable drained;
+};
+
+} // namespace senjo
+
+#endif // SENJO_OUTPUT_QUEUE_H
@@ -0,0 +1,321 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2019 Shawn Chidester <zd3nik@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//-----------------------------------------------------------------------------
+
+
+#include "OutputSink.h"
+#include "OutputQueue.h"
+#include <iostream>
+
+#ifndef WIN32
+#include <cerrno>
+#include <climits>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace senjo {
+
+//-----------------------------------------------------------------------------
+// the calling thread's current sink, null means standardOutput()
+//-----------------------------------------------------------------------------
+static thread_local OutputSink* _current = nullptr;
+
+//-----------------------------------------------------------------------------
+//! \brief Call \p callback for each '\n' terminated line in \p text
+//-----------------------------------------------------------------------------
+template<typename Callback>
+static void forEachLine(const std::string_view text, Callback callback) {
+  size_t begin = 0;
+  while (begin < text.size()) {
+    size_t end = text.find('\n', begin);
+    if (end == std::string_view::npos) {
+      end = text.size();
+    }
+    callback(text.substr(begin, (end - begin)));
+    begin = (end + 1);
+  }
+}
+
+//-----------------------------------------------------------------------------
+OutputSink::Scope::Scope(OutputSink& sink)
+  : previous(_current)
+{
+  _current = &sink;
+}
+
+//-----------------------------------------------------------------------------
+OutputSink::Scope::~Scope() {
+  _current = previous;
+}
+
+//-----------------------------------------------------------------------------
+OutputSink::OutputSink(const FlushPolicy flushPolicy)
+  : last(now()),
+    policy(flushPolicy),
+    active(nullptr)
+{}
+
+//-----------------------------------------------------------------------------
+OutputSink::~OutputSink() {
+}
+
+//-----------------------------------------------------------------------------
+OutputSink& OutputSink::current() {
+  return _current ? *_current : *standardOutput();
+}
+
+//-----------------------------------------------------------------------------
+const std::shared_ptr<OutputSink>& OutputSink::standardOutput() {
+  static const std::shared_ptr<OutputSink> sink(new StdoutSink());
+  return sink;
+}
+
+//-----------------------------------------------------------------------------
+void OutputSink::submit(std::string& text) {
+  if (text.empty()) {
+    return;
+  }
+
+  OutputQueue* queue = active;
+  if (queue) {
+    queue->push(text);
+  }
+  else {
+    std::lock_guard<std::mutex> lock(mutex);
+    doWrite(text);
+    if (policy == FlushEachWrite) {
+      doFlush();
+    }
+    text.clear();
+  }
+  last = now();
+}
+
+//-----------------------------------------------------------------------------
+void OutputSink::flush() {
+  std::string held;
+  throttle.release(held);
+  submit(held);
+
+  OutputQueue* queue = active;
+  if (queue) {
+    queue->flush();
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  doFlush();
+}
+
+//-----------------------------------------------------------------------------
+void OutputSink::setAsync(const bool enable, const size_t capacity) {
+  std::lock_guard<std::mutex> lock(asyncMutex);
+  if (enable && !queue) {
+    {
+      std::lock_guard<std::mutex> writeLock(mutex);
+      doFlush();
+    }
+    queue.reset(new OutputQueue(capacity,
+        [this](const std::string_view* texts, const size_t count) {
+          writeBatch(texts, count);
+        }));
+    queue->run();
+    active = queue.get();
+  }
+  else if (!enable && queue) {
+    // destroying the queue writes anything still in it
+    active = nullptr;
+    queue.reset();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void OutputSink::close() {
+  setAsync(false);
+  flush();
+}
+
+//-----------------------------------------------------------------------------
+void OutputSink::doWrite(const std::string_view* texts, const size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    doWrite(texts[i]);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void OutputSink::writeBatch(const std::string_view* texts, const size_t count)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  doWrite(texts, count);
+  if (policy == FlushEachWrite) {
+    doFlush();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void StdoutSink::doWrite(const std::string_view text) {
+  std::cout.write(text.data(), std::streamsize(text.size()));
+}
+
+//-----------------------------------------------------------------------------
+void StdoutSink::doWrite(const std::string_view* texts, const size_t count) {
+#ifdef WIN32
+  OutputSink::doWrite(texts, count);
+#else
+  // anything written directly to std::cout goes first
+  std::cout.flush();
+
+#if defined(IOV_MAX) && (IOV_MAX < 64)
+  static const size_t MAX_IOV = IOV_MAX;
+#else
+  static const size_t MAX_IOV = 64;
+#endif
+
+  iovec iov[MAX_IOV];
+  size_t done = 0;
+  while (done < count) {
+    int remaining = 0;
+    for (; (done < count) && (size_t(remaining) < MAX_IOV); ++done) {
+      iov[remaining].iov_base = const_cast<char*>(texts[done].data());
+      iov[remaining].iov_len = texts[done].size();
+      remaining++;
+    }
+
+    // handle partial writes by skipping whatever has already been written
+    iovec* next = iov;
+    while (remaining > 0) {
+      ssize_t written = writev(STDOUT_FILENO, next, remaining);
+      if (written < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return; // stdout is gone, nothing else we can do
+      }
+      while ((remaining > 0) && (size_t(written) >= next->iov_len)) {
+        written -= next->iov_len;
+        next++;
+        remaining--;
+      }
+      if (remaining > 0) {
+        next->iov_base = static_cast<char*>(next->iov_base) + written;
+        next->iov_len -= size_t(written);
+      }
+    }
+  }
+#endif
+}
+
+//-----------------------------------------------------------------------------
+void StdoutSink::doFlush() {
+  std::cout.flush();
+}
+
+//-----------------------------------------------------------------------------
+FileSink::FileSink(const std::string& path, const bool append,
+                   const FlushPolicy policy)
+  : OutputSink(policy),
+    file(path.c_str(), (append ? (std::ios::out | std::ios::app)
+                               : (std::ios::out | std::ios::trunc)))
+{}
+
+//-----------------------------------------------------------------------------
+void FileSink::doWrite(const std::string_view text) {
+  file.write(text.data(), std::streamsize(text.size()));
+}
+
+//-----------------------------------------------------------------------------
+void FileSink::doFlush() {
+  file.flush();
+}
+
+//-----------------------------------------------------------------------------
+RingSink::RingSink(const size_t capacity)
+  : lines(capacity ? capacity : 1),
+    count(0)
+{}
+
+//-----------------------------------------------------------------------------
+void RingSink::doWrite(const std::string_view text) {
+  std::lock_guard<std::mutex> lock(ringMutex);
+  forEachLine(text, [this](const std::string_view line) {
+    // assign rather than replace so each slot reuses its buffer
+    lines[count++ % lines.size()].assign(line.data(), line.size());
+  });
+}
+
+//-----------------------------------------------------------------------------
+std::vector<std::string> RingSink::getLines() {
+  std::lock_guard<std::mutex> lock(ringMutex);
+  std::vector<std::string> result;
+  const uint64_t size = lines.size();
+  for (uint64_t i = ((count > size) ? (count - size) : 0); i < count; ++i) {
+    result.push_back(lines[i % size]);
+  }
+  return result;
+}
+
+//-----------------------------------------------------------------------------
+uint64_t RingSink::getCount() {
+  std::lock_guard<std::mutex> lock(ringMutex);
+  return count;
+}
+
+//-----------------------------------------------------------------------------
+void RingSink::clear() {
+  std::lock_guard<std::mutex> lock(ringMutex);
+  count = 0;
+}
+
+//-----------------------------------------------------------------------------
+CallbackSink::CallbackSink(const Callback& callback)
+  : callback(callback)
+{}
+
+//-----------------------------------------------------------------------------
+void CallbackSink::doWrite(const std::string_view text) {
+  forEachLine(text, callback);
+}
+
+//-----------------------------------------------------------------------------
+TeeSink::TeeSink(const std::shared_ptr<OutputSink>& first,
+                 const std::shared_ptr<OutputSink>& second)
+  : OutputSink(FlushOnRequest),
+    first(first),
+    second(second)
+{}
+
+//-----------------------------------------------------------------------------
+void TeeSink::doWrite(const std::string_view text) {
+  // each submit() swaps buffers with its sink, so these never reallocate
+  // once warmed up
+  firstText.assign(text.data(), text.size());
+  first->submit(firstText);
+  secondText.assign(text.data(), text.size());
+  second->submit(secondText);
+}
+
+//-----------------------------------------------------------------------------
+void TeeSink::doFlush() {
+  first->flush();
+  second->flush();
+}
+
+} // namespace senjo
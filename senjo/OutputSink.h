@@ -0,0 +1,313 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2019 Shawn Chidester <zd3nik@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//-----------------------------------------------------------------------------
+
+
+#ifndef SENJO_OUTPUT_SINK_H
+#define SENJO_OUTPUT_SINK_H
+
+#include "InfoThrottle.h"
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace senjo {
+
+class OutputQueue;
+
+//-----------------------------------------------------------------------------
+//! \brief Destination for everything written with Output
+//! Each sink has its own lock, flush policy, optional asynchronous writer
+//! thread (see setAsync()), info line throttle, and last output time, so
+//! several UCIAdapter instances can share a process without sharing any
+//! output state.
+//!
+//! Output writes to the calling thread's current sink.  By default that is
+//! the process wide standardOutput() sink.  UCIAdapter makes its own sink
+//! current while executing a command, and senjo::Thread passes the current
+//! sink of the thread that calls run() on to the new thread.  Threads created
+//! by other means, e.g. an engine's helper search threads, should do the same
+//! with OutputSink::Scope:
+//!
+//!   OutputSink& sink = OutputSink::current();
+//!   std::thread helper([&sink]() {
+//!     OutputSink::Scope scope(sink);
+//!     ...
+//!   });
+//!
+//! To implement a sink override doWrite() and optionally doFlush(), and call
+//! close() from the derived class destructor.
+//-----------------------------------------------------------------------------
+class OutputSink {
+public:
+  enum FlushPolicy {
+    FlushEachWrite, ///< Flush after every line (or batch of lines)
+    FlushOnRequest  ///< Flush only when flush() is called
+  };
+
+  //--------------------------------------------------------------------------
+  //! \brief Makes a sink current for the calling thread until destroyed
+  //--------------------------------------------------------------------------
+  class Scope {
+  public:
+    explicit Scope(OutputSink& sink);
+    ~Scope();
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+  private:
+    OutputSink* previous;
+  };
+
+  explicit OutputSink(const FlushPolicy policy = FlushEachWrite);
+  virtual ~OutputSink();
+
+  OutputSink(const OutputSink&) = delete;
+  OutputSink& operator=(const OutputSink&) = delete;
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the calling thread's current sink
+  //! \return The sink made current by the innermost Scope on this thread,
+  //!         or the standardOutput() sink if there is none
+  //--------------------------------------------------------------------------
+  static OutputSink& current();
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the process wide sink that writes to stdout
+  //! \return The standard output sink, never null
+  //--------------------------------------------------------------------------
+  static const std::shared_ptr<OutputSink>& standardOutput();
+
+  //--------------------------------------------------------------------------
+  //! \brief Write complete output text
+  //! \param[in,out] text One or more lines, each ending with '\n'.
+  //!                     Replaced with an empty string.
+  //--------------------------------------------------------------------------
+  void submit(std::string& text);
+
+  //--------------------------------------------------------------------------
+  //! \brief Write everything submitted so far, including held back info
+  //! lines, and flush it to the underlying destination
+  //--------------------------------------------------------------------------
+  void flush();
+
+  //--------------------------------------------------------------------------
+  //! \brief Enable or disable writing on a dedicated thread
+  //! When enabled submit() only adds text to a lock-free queue and a writer
+  //! thread passes it to doWrite() in batches.  Should only be called while
+  //! no other threads are writing to this sink.  Disabling writes all queued
+  //! text first.
+  //! \param[in] enable true to enable asynchronous writing
+  //! \param[in] capacity Number of lines that can be queued before submit()
+  //!                     blocks waiting for the writer thread
+  //--------------------------------------------------------------------------
+  void setAsync(const bool enable, const size_t capacity = 4096);
+
+  //--------------------------------------------------------------------------
+  //! \brief Is asynchronous writing enabled?
+  //! \return true if asynchronous writing is enabled
+  //--------------------------------------------------------------------------
+  bool isAsync() const { return (active != nullptr); }
+
+  void setFlushPolicy(const FlushPolicy value) { policy = value; }
+  FlushPolicy getFlushPolicy() const { return policy; }
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the info line throttle for output written to this sink
+  //! \return Reference to the info line throttle
+  //--------------------------------------------------------------------------
+  InfoThrottle& getThrottle() { return throttle; }
+
+  //--------------------------------------------------------------------------
+  //! \brief Get timestamp of the last time text was submitted
+  //! \return Timestamp of last submit, or when the sink was created
+  //--------------------------------------------------------------------------
+  TimePoint lastOutput() const { return last; }
+
+protected:
+  //--------------------------------------------------------------------------
+  //! \brief Write text to the destination
+  //! Never called concurrently for the same sink.
+  //! \param[in] text One or more complete lines, each ending with '\n'
+  //--------------------------------------------------------------------------
+  virtual void doWrite(const std::string_view text) = 0;
+
+  //--------------------------------------------------------------------------
+  //! \brief Write a batch of text from the asynchronous writer thread
+  //! The default implementation calls doWrite() for each element.
+  //! \param[in] texts Array of text to write, each with complete lines
+  //! \param[in] count Number of elements in \p texts
+  //--------------------------------------------------------------------------
+  virtual void doWrite(const std::string_view* texts, const size_t count);
+
+  //--------------------------------------------------------------------------
+  //! \brief Flush anything buffered by doWrite() to the destination
+  //--------------------------------------------------------------------------
+  virtual void doFlush() { }
+
+  //--------------------------------------------------------------------------
+  //! \brief Stop asynchronous writing and flush
+  //! Must be called by derived class destructors, so that nothing calls
+  //! doWrite() after the derived class has been destroyed.
+  //--------------------------------------------------------------------------
+  void close();
+
+private:
+  void writeBatch(const std::string_view* texts, const size_t count);
+
+  std::mutex mutex;       // serializes doWrite() and doFlush()
+  std::mutex asyncMutex;  // serializes setAsync()
+  std::atomic<TimePoint> last;
+  std::atomic<FlushPolicy> policy;
+  std::atomic<OutputQueue*> active;
+  std::unique_ptr<OutputQueue> queue;
+  InfoThrottle throttle;
+};
+
+//-----------------------------------------------------------------------------
+//! \brief Writes to stdout, in batches with writev() when asynchronous
+//-----------------------------------------------------------------------------
+class StdoutSink : public OutputSink {
+public:
+  StdoutSink() : OutputSink(FlushEachWrite) { }
+  ~StdoutSink() { close(); }
+
+protected:
+  void doWrite(const std::string_view text);
+  void doWrite(const std::string_view* texts, const size_t count);
+  void doFlush();
+};
+
+//-----------------------------------------------------------------------------
+//! \brief Writes to a file, only flushed on request by default
+//-----------------------------------------------------------------------------
+class FileSink : public OutputSink {
+public:
+  //--------------------------------------------------------------------------
+  //! \brief Constructor, use isOpen() to check whether the file was opened
+  //! \param[in] path The file to write to
+  //! \param[in] append true to append to the file rather than replace it
+  //! \param[in] policy When to flush the file
+  //--------------------------------------------------------------------------
+  explicit FileSink(const std::string& path, const bool append = false,
+                    const FlushPolicy policy = FlushOnRequest);
+  ~FileSink() { close(); }
+
+  bool isOpen() const { return file.is_open(); }
+
+protected:
+  void doWrite(const std::string_view text);
+  void doFlush();
+
+private:
+  std::ofstream file;
+};
+
+//-----------------------------------------------------------------------------
+//! \brief Keeps the most recent lines in memory
+//! Useful for batch jobs and tests that need to inspect engine output.
+//-----------------------------------------------------------------------------
+class RingSink : public OutputSink {
+public:
+  //--------------------------------------------------------------------------
+  //! \brief Constructor
+  //! \param[in] capacity Maximum number of lines to keep
+  //--------------------------------------------------------------------------
+  explicit RingSink(const size_t capacity);
+  ~RingSink() { close(); }
+
+  //--------------------------------------------------------------------------
+  //! \brief Get a copy of the lines currently held, oldest first
+  //! \return The lines currently held, without trailing '\n'
+  //--------------------------------------------------------------------------
+  std::vector<std::string> getLines();
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the number of lines written since construction or clear()
+  //! \return The number of lines written, including those no longer held
+  //--------------------------------------------------------------------------
+  uint64_t getCount();
+
+  //--------------------------------------------------------------------------
+  //! \brief Discard all lines
+  //--------------------------------------------------------------------------
+  void clear();
+
+protected:
+  void doWrite(const std::string_view text);
+
+private:
+  std::mutex ringMutex;
+  std::vector<std::string> lines;
+  uint64_t count;
+};
+
+//-----------------------------------------------------------------------------
+//! \brief Passes each line to a callback function
+//! The callback is never called concurrently and must not write to the
+//! same sink.
+//-----------------------------------------------------------------------------
+class CallbackSink : public OutputSink {
+public:
+  typedef std::function<void(const std::string_view line)> Callback;
+
+  //--------------------------------------------------------------------------
+  //! \brief Constructor
+  //! \param[in] callback Function to call with each line, without its '\n'
+  //--------------------------------------------------------------------------
+  explicit CallbackSink(const Callback& callback);
+  ~CallbackSink() { close(); }
+
+protected:
+  void doWrite(const std::string_view text);
+
+private:
+  const Callback callback;
+};
+
+//-----------------------------------------------------------------------------
+//! \brief Writes everything to two other sinks
+//! Each sink keeps its own locking, flush policy, and asynchronous mode, so
+//! e.g. a log file can be written on its own thread without slowing output
+//! to the GUI.  Info line throttling is only applied by the TeeSink itself.
+//-----------------------------------------------------------------------------
+class TeeSink : public OutputSink {
+public:
+  TeeSink(const std::shared_ptr<OutputSink>& first,
+          const std::shared_ptr<OutputSink>& second);
+  ~TeeSink() { close(); }
+
+protected:
+  void doWrite(const std::string_view text);
+  void doFlush();
+
+private:
+  std::shared_ptr<OutputSink> first;
+  std::shared_ptr<OutputSink> second;
+  std::string firstText;
+  std::string secondText;
+};
+
+} // namespace senjo
+
+#endif // SENJO_OUTPUT_SINK_H
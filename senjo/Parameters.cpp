@@ -25,33 +25,35 @@
 namespace senjo {
 
 //-----------------------------------------------------------------------------
-Parameters::Parameters(const std::string& commandLine) {
+Parameters::Parameters(const std::string_view commandLine) {
   parse(commandLine);
 }
 
 //-----------------------------------------------------------------------------
-void Parameters::parse(const std::string& str) {
-  std::stringstream ss(str);
-  std::string param;
+void Parameters::parse(const std::string_view str) {
   clear();
-  while (ss >> param) {
-    push_back(param);
+  TokenCursor tokens(str);
+  while (!tokens.empty()) {
+    emplace_back(tokens.next());
   }
 }
 
 //-----------------------------------------------------------------------------
 std::string Parameters::toString() const {
-  std::stringstream ss;
-  bool first = true;
-  for (std::string param : *this) {
-    if (first) {
-      first = false;
-    } else {
-      ss << ' ';
+  size_t len = 0;
+  for (const std::string& param : *this) {
+    len += (param.size() + 1);
+  }
+
+  std::string str;
+  str.reserve(len);
+  for (const std::string& param : *this) {
+    if (str.size()) {
+      str += ' ';
     }
-    ss << param;
+    str += param;
   }
-  return ss.str();
+  return str;
 }
 
 //-----------------------------------------------------------------------------
@@ -24,18 +24,24 @@
 #define SENJO_PARAMETERS_H
 
 #include "Platform.h"
+#include "TokenCursor.h"
 
 namespace senjo {
 
+//-----------------------------------------------------------------------------
+//! \brief Whitespace delimited parameters of a command, one string each
+//! Convenient for commands that rearrange or keep their parameters.  Use a
+//! TokenCursor instead where parsing must not allocate memory.
+//-----------------------------------------------------------------------------
 class Parameters : public std::list<std::string> {
 public:
   Parameters() = default;
-  Parameters(const std::string& commandLine);
+  Parameters(const std::string_view commandLine);
 
   //---------------------------------------------------------------------------
   //! \brief Initialize this instance from the given string
   //---------------------------------------------------------------------------
-  void parse(const std::string& str);
+  void parse(const std::string_view str);
 
   //---------------------------------------------------------------------------
   //! \brief Join the parameters together into a single space delimited string
@@ -87,18 +93,11 @@ public:
   //-----------------------------------------------------------------------------
   template<typename T>
   T popNumber(const T& defaultValue = 0) {
-    if (empty()) {
-      return defaultValue;
-    }
-
-    std::stringstream ss(front());
-    T value;
-    if (ss >> value) {
+    T value = defaultValue;
+    if (size() && parseNumber(front(), value)) {
       pop_front();
-      return value;
     }
-
-    return defaultValue;
+    return value;
   }
 
   //-----------------------------------------------------------------------------
@@ -115,8 +114,7 @@ public:
     }
 
     pop_front();
-    std::stringstream ss(front());
-    if (ss >> value) {
+    if (parseNumber(front(), value)) {
       pop_front();
       return true;
     }
@@ -0,0 +1,373 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2019 Shawn Chidester <zd3nik@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//-----------------------------------------------------------------------------
+
+
+#include "PerftCache.h"
+#include "Output.h"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+
+namespace senjo {
+
+//-----------------------------------------------------------------------------
+bool PerftCache::open(const std::string& file, const std::string& engineVer) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (out.is_open()) {
+    out.close();
+  }
+
+  entries.clear();
+  otherLines.clear();
+  fileName = file;
+  version = engineVer;
+
+  std::ifstream fs(fileName);
+  std::string line;
+  while (std::getline(fs, line)) {
+    if (line.empty() || (line[0] == '#')) {
+      continue;
+    }
+
+    // <version> TAB <depth> TAB <leafs> TAB <fen>
+    const size_t a = line.find('\t');
+    const size_t b = (a == std::string::npos) ? a : line.find('\t', a + 1);
+    const size_t c = (b == std::string::npos) ? b : line.find('\t', b + 1);
+    if (c == std::string::npos) {
+      Output() << "Ignoring invalid perft cache entry: " << line;
+      continue;
+    }
+
+    if (line.compare(0, a, version)) {
+      otherLines.push_back(line);
+      continue;
+    }
+
+    const int depth = toNumber<int>(line.substr(a + 1, (b - a - 1)));
+    const uint64_t leafs = toNumber<uint64_t>(line.substr(b + 1, (c - b - 1)));
+    if ((depth < 1) || !leafs) {
+      Output() << "Ignoring invalid perft cache entry: " << line;
+      continue;
+    }
+
+    entries[makeKey(line.substr(c + 1), depth)] = leafs;
+  }
+  fs.close();
+
+  out.open(fileName, std::ios::out | std::ios::app);
+  if (!out) {
+    Output() << "Cannot open perft cache file: " << fileName;
+    return false;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+size_t PerftCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return entries.size();
+}
+
+//-----------------------------------------------------------------------------
+bool PerftCache::lookup(const std::string& fen, const int depth,
+                        uint64_t& leafs) const
+{
+  const std::string pos = canonical(fen);
+  if (pos.empty()) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = entries.find(makeKey(pos, depth));
+  if (it == entries.end()) {
+    return false;
+  }
+  leafs = it->second;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void PerftCache::store(const std::string& fen, const int depth,
+                       const uint64_t leafs)
+{
+  const std::string pos = canonical(fen);
+  if (pos.empty() || (depth < 1) || !leafs) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  uint64_t& cached = entries[makeKey(pos, depth)];
+  if (cached != leafs) {
+    cached = leafs;
+    if (out.is_open()) {
+      out << version << '\t' << depth << '\t' << leafs << '\t' << pos
+          << std::endl;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+std::vector<PerftCache::Entry> PerftCache::sample(const size_t count,
+                                                  const uint64_t seed) const
+{
+  std::vector<Entry> result;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    result.reserve(entries.size());
+    for (const auto& entry : entries) {
+      const size_t space = entry.first.find(' ');
+      result.push_back(Entry{entry.first.substr(space + 1),
+                             toNumber<int>(entry.first.substr(0, space)),
+                             entry.second});
+    }
+  }
+
+  // sort first so the sample only depends on the seed and the cache contents
+  std::sort(result.begin(), result.end(), [](const Entry& a, const Entry& b) {
+    return (a.depth != b.depth) ? (a.depth < b.depth) : (a.fen < b.fen);
+  });
+  std::shuffle(result.begin(), result.end(), std::mt19937_64(seed));
+  if (result.size() > count) {
+    result.resize(count);
+  }
+  return result;
+}
+
+//-----------------------------------------------------------------------------
+bool PerftCache::erase(const std::vector<Entry>& remove) {
+  std::lock_guard<std::mutex> lock(mutex);
+  for (const Entry& entry : remove) {
+    entries.erase(makeKey(entry.fen, entry.depth));
+  }
+  return rewrite();
+}
+
+//-----------------------------------------------------------------------------
+bool PerftCache::rewrite() {
+  if (out.is_open()) {
+    out.close();
+  }
+
+  // write to a temporary file first so a failure doesn't lose the cache
+  const std::string tmpName = (fileName + ".tmp");
+  std::ofstream fs(tmpName, std::ios::out | std::ios::trunc);
+  for (const std::string& line : otherLines) {
+    fs << line << '\n';
+  }
+  for (const auto& entry : entries) {
+    const size_t space = entry.first.find(' ');
+    fs << version << '\t' << entry.first.substr(0, space) << '\t'
+       << entry.second << '\t' << entry.first.substr(space + 1) << '\n';
+  }
+  fs.close();
+
+  if (!fs || std::rename(tmpName.c_str(), fileName.c_str())) {
+    Output() << "Cannot rewrite perft cache file: " << fileName;
+    std::remove(tmpName.c_str());
+    out.open(fileName, std::ios::out | std::ios::app);
+    return false;
+  }
+
+  out.open(fileName, std::ios::out | std::ios::app);
+  return out.is_open();
+}
+
+//-----------------------------------------------------------------------------
+std::string PerftCache::makeKey(const std::string& fen, const int depth) {
+  return (std::to_string(depth) + ' ' + fen);
+}
+
+//-----------------------------------------------------------------------------
+std::string PerftCache::canonical(const std::string& fen) {
+  const std::string normal = normalize(fen);
+  if (normal.empty()) {
+    return normal;
+  }
+  const std::string mirror = flip(normal);
+  return std::min(normal, mirror);
+}
+
+//-----------------------------------------------------------------------------
+std::string PerftCache::normalize(const std::string& fen) {
+  std::istringstream is(fen);
+  std::string placement;
+  std::string color;
+  std::string castle;
+  std::string ep;
+  if (!(is >> placement >> color >> castle >> ep)) {
+    return "";
+  }
+
+  // expand the placement field into 64 squares, a8 first
+  char board[64];
+  int sqr = 0;
+  int rankLength = 0;
+  for (const char ch : placement) {
+    if (ch == '/') {
+      if (rankLength != 8) {
+        return "";
+      }
+      rankLength = 0;
+    }
+    else if ((ch >= '1') && (ch <= '8')) {
+      for (int i = (ch - '0'); i > 0; --i) {
+        if ((sqr >= 64) || (rankLength >= 8)) {
+          return "";
+        }
+        board[sqr++] = ' ';
+        rankLength++;
+      }
+    }
+    else if (strchr("PNBRQKpnbrqk", ch)) {
+      if ((sqr >= 64) || (rankLength >= 8)) {
+        return "";
+      }
+      board[sqr++] = ch;
+      rankLength++;
+    }
+    else {
+      return "";
+    }
+  }
+  if ((sqr != 64) || (rankLength != 8)) {
+    return "";
+  }
+
+  if ((color != "w") && (color != "b")) {
+    return "";
+  }
+
+  std::string rights;
+  for (const char ch : std::string("KQkq")) {
+    if (castle.find(ch) != std::string::npos) {
+      rights += ch;
+    }
+  }
+  if (rights.empty()) {
+    rights = "-";
+  }
+
+  // keep the en passant square only if a pawn is in position to capture
+  const bool white = (color == "w");
+  if ((ep.size() == 2) && (ep[0] >= 'a') && (ep[0] <= 'h') &&
+      (ep[1] == (white ? '6' : '3')))
+  {
+    const int x = (ep[0] - 'a');
+    const int y = (white ? 3 : 4); // row of the capturing pawns, a8 = row 0
+    const char pawn = (white ? 'P' : 'p');
+    if (!(((x > 0) && (board[(y * 8) + x - 1] == pawn)) ||
+          ((x < 7) && (board[(y * 8) + x + 1] == pawn))))
+    {
+      ep = "-";
+    }
+  }
+  else {
+    ep = "-";
+  }
+
+  // re-compress the placement field so equivalent inputs compare equal
+  std::string result;
+  for (int y = 0; y < 8; ++y) {
+    int empty = 0;
+    for (int x = 0; x < 8; ++x) {
+      const char ch = board[(y * 8) + x];
+      if (ch == ' ') {
+        empty++;
+        continue;
+      }
+      if (empty) {
+        result += static_cast<char>('0' + empty);
+        empty = 0;
+      }
+      result += ch;
+    }
+    if (empty) {
+      result += static_cast<char>('0' + empty);
+    }
+    if (y < 7) {
+      result += '/';
+    }
+  }
+
+  return (result + ' ' + color + ' ' + rights + ' ' + ep);
+}
+
+//-----------------------------------------------------------------------------
+std::string PerftCache::flip(const std::string& fen) {
+  std::istringstream is(fen);
+  std::string placement;
+  std::string color;
+  std::string castle;
+  std::string ep;
+  if (!(is >> placement >> color >> castle >> ep)) {
+    return "";
+  }
+
+  auto swapCase = [](std::string& str) {
+    for (char& ch : str) {
+      if (isupper(ch)) {
+        ch = static_cast<char>(tolower(ch));
+      }
+      else if (islower(ch)) {
+        ch = static_cast<char>(toupper(ch));
+      }
+    }
+  };
+
+  // reverse rank order
+  std::string result;
+  size_t end = placement.size();
+  while (true) {
+    const size_t slash = placement.rfind('/', (end ? (end - 1) : 0));
+    const size_t begin = (slash == std::string::npos) ? 0 : (slash + 1);
+    if (result.size()) {
+      result += '/';
+    }
+    result += placement.substr(begin, (end - begin));
+    if (slash == std::string::npos) {
+      break;
+    }
+    end = slash;
+  }
+  swapCase(result);
+
+  std::string rights;
+  if (castle != "-") {
+    swapCase(castle);
+    for (const char ch : std::string("KQkq")) {
+      if (castle.find(ch) != std::string::npos) {
+        rights += ch;
+      }
+    }
+  }
+  else {
+    rights = "-";
+  }
+
+  if (ep.size() == 2) {
+    ep[1] = static_cast<char>('1' + ('8' - ep[1]));
+  }
+
+  return (result + ((color == "w") ? " b " : " w ") + rights + ' ' + ep);
+}
+
+} // namespace senjo
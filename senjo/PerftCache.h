@@ -0,0 +1,143 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2019 Shawn Chidester <zd3nik@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//-----------------------------------------------------------------------------
+
+
+#ifndef SENJO_PERFT_CACHE_H
+#define SENJO_PERFT_CACHE_H
+
+#include "Platform.h"
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace senjo {
+
+//-----------------------------------------------------------------------------
+//! \brief On-disk cache of verified perft results
+//! Entries are keyed by canonical position, depth, and engine version.  The
+//! canonical position ignores the move counters and any en passant square
+//! that can't be captured, and a position and its color-flipped mirror image
+//! share the same entry since they always have the same perft results.
+//! The cache file is plain text, one entry per line:
+//!   <engine version> TAB <depth> TAB <leafs> TAB <canonical FEN>
+//! New entries are appended to the file as soon as they're stored.
+//-----------------------------------------------------------------------------
+class PerftCache {
+public:
+  struct Entry {
+    std::string fen;
+    int         depth;
+    uint64_t    leafs;
+  };
+
+  //--------------------------------------------------------------------------
+  //! \brief Load the given cache file, creating it if it doesn't exist
+  //! Only entries for \p engineVersion are used, others are left as-is.
+  //! \param[in] fileName Path to the cache file
+  //! \param[in] engineVersion Engine name and version
+  //! \return false if the cache file can't be opened for writing
+  //--------------------------------------------------------------------------
+  bool open(const std::string& fileName, const std::string& engineVersion);
+
+  //--------------------------------------------------------------------------
+  //! \brief Is the cache file open?
+  //! \return true if open() succeeded
+  //--------------------------------------------------------------------------
+  bool isOpen() const { return out.is_open(); }
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the number of entries for the current engine version
+  //! \return The number of entries for the current engine version
+  //--------------------------------------------------------------------------
+  size_t size() const;
+
+  //--------------------------------------------------------------------------
+  //! \brief Find the cached leaf count for the given position and depth
+  //! \param[in] fen The position, any text after the FEN is ignored
+  //! \param[in] depth The perft depth
+  //! \param[out] leafs Set to the cached leaf count if found
+  //! \return true if a cached leaf count was found
+  //--------------------------------------------------------------------------
+  bool lookup(const std::string& fen, const int depth, uint64_t& leafs) const;
+
+  //--------------------------------------------------------------------------
+  //! \brief Add a verified leaf count to the cache
+  //! \param[in] fen The position, any text after the FEN is ignored
+  //! \param[in] depth The perft depth
+  //! \param[in] leafs The verified leaf count
+  //--------------------------------------------------------------------------
+  void store(const std::string& fen, const int depth, const uint64_t leafs);
+
+  //--------------------------------------------------------------------------
+  //! \brief Get a random sample of entries for the current engine version
+  //! \param[in] count The maximum number of entries to return
+  //! \param[in] seed Random number generator seed
+  //! \return Up to \p count randomly selected entries
+  //--------------------------------------------------------------------------
+  std::vector<Entry> sample(const size_t count, const uint64_t seed) const;
+
+  //--------------------------------------------------------------------------
+  //! \brief Remove the given entries and rewrite the cache file
+  //! \param[in] entries The entries to remove
+  //! \return false if the cache file could not be rewritten
+  //--------------------------------------------------------------------------
+  bool erase(const std::vector<Entry>& entries);
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the canonical form of the given position
+  //! \param[in] fen The position, any text after the FEN is ignored
+  //! \return The lesser of the normalized position and its mirror image,
+  //!         empty if \p fen is not a valid FEN string
+  //--------------------------------------------------------------------------
+  static std::string canonical(const std::string& fen);
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the normalized form of the given position
+  //! \param[in] fen The position, any text after the FEN is ignored
+  //! \return The first four FEN fields, en passant square removed if it
+  //!         can't be captured, empty if \p fen is not a valid FEN string
+  //--------------------------------------------------------------------------
+  static std::string normalize(const std::string& fen);
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the color-flipped mirror image of a normalized position
+  //! \param[in] fen A normalized position
+  //! \return \p fen with ranks reversed and colors swapped
+  //--------------------------------------------------------------------------
+  static std::string flip(const std::string& fen);
+
+private:
+  static std::string makeKey(const std::string& fen, const int depth);
+  bool rewrite();
+
+  std::unordered_map<std::string, uint64_t> entries;
+  std::vector<std::string> otherLines;
+  std::ofstream out;
+  std::string fileName;
+  std::string version;
+  mutable std::mutex mutex;
+};
+
+} // namespace senjo
+
+#endif // SENJO_PERFT_CACHE_H
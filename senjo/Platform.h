@@ -28,6 +28,7 @@
 #endif
 
 #include <string>
+#include <string_view>
 #include <chrono>
 #include <thread>
 #include <sstream>
@@ -63,6 +64,13 @@ inline uint64_t getMsecs(const TimePoint& begin, const TimePoint& end = now()) {
   return uint64_t(msecs.count());
 }
 
+//-----------------------------------------------------------------------------
+inline uint64_t getUsecs(const TimePoint& begin, const TimePoint& end = now()) {
+  auto duration = (end - begin);
+  auto usecs = std::chrono::duration_cast<std::chrono::microseconds>(duration);
+  return uint64_t(usecs.count());
+}
+
 //-----------------------------------------------------------------------------
 template<typename T>
 inline double average(const T total, const T count) {
@@ -115,7 +123,7 @@ inline std::string trim(const std::string& str,
 }
 
 //-----------------------------------------------------------------------------
-inline bool iEqual(const std::string& a, const std::string& b) {
+inline bool iEqual(const std::string_view a, const std::string_view b) {
   return ((a.size() == b.size()) &&
           std::equal(a.begin(), a.end(), b.begin(), [](char c1, char c2) {
     return (c1 == c2) || (std::toupper(c1) == std::toupper(c2));
@@ -123,7 +131,16 @@ inline bool iEqual(const std::string& a, const std::string& b) {
 }
 
 //-----------------------------------------------------------------------------
-inline bool isMove(const std::string& str) {
+inline std::string toLower(const std::string_view text) {
+  std::string str(text);
+  for (char& ch : str) {
+    ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+  }
+  return str;
+}
+
+//-----------------------------------------------------------------------------
+inline bool isMove(const std::string_view str) {
   return (str.size() >= 4) &&
          (str[0] >= 'a') && (str[0] <= 'h') &&
          (str[1] >= '1') && (str[1] <= '8') &&
@@ -0,0 +1,840 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2015-2019 Shawn Chidester <zd3nik@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include "ReferenceBoard.h"
+#include "Output.h"
+#include <mutex>
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+namespace senjo {
+
+//-----------------------------------------------------------------------------
+// piece types, colors, and castle rights
+//-----------------------------------------------------------------------------
+enum { Pawn, Knight, Bishop, Rook, Queen, King };
+enum { White, Black };
+enum {
+  WhiteShort = 1,
+  WhiteLong  = 2,
+  BlackShort = 4,
+  BlackLong  = 8
+};
+
+//-----------------------------------------------------------------------------
+// move encoding: from (6 bits), to (6 bits), promo type (3 bits), flag (2 bits)
+//-----------------------------------------------------------------------------
+enum { NormalMove, CastleMove, PassantMove, PawnLunge };
+
+static inline int fromSqr(const uint32_t mv) { return (mv & 0x3F); }
+static inline int toSqr(const uint32_t mv)   { return ((mv >> 6) & 0x3F); }
+static inline int promoOf(const uint32_t mv) { return ((mv >> 12) & 0x7); }
+static inline int flagOf(const uint32_t mv)  { return ((mv >> 15) & 0x3); }
+
+static inline uint32_t toMove(const int from, const int to,
+                              const int promo = 0, const int flag = NormalMove)
+{
+  return uint32_t(from | (to << 6) | (promo << 12) | (flag << 15));
+}
+
+//-----------------------------------------------------------------------------
+static inline uint64_t bit(const int sqr) { return (1ULL << sqr); }
+
+//-----------------------------------------------------------------------------
+static inline int lsb(const uint64_t bb) {
+#if defined(_MSC_VER)
+  unsigned long idx;
+  _BitScanForward64(&idx, bb);
+  return int(idx);
+#else
+  return __builtin_ctzll(bb);
+#endif
+}
+
+//-----------------------------------------------------------------------------
+static inline int popLsb(uint64_t& bb) {
+  const int sqr = lsb(bb);
+  bb &= (bb - 1);
+  return sqr;
+}
+
+//-----------------------------------------------------------------------------
+static inline int popCount(uint64_t bb) {
+#if defined(_MSC_VER)
+  return int(__popcnt64(bb));
+#else
+  return __builtin_popcountll(bb);
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// lookup tables, populated once by initTables()
+//-----------------------------------------------------------------------------
+struct Magic {
+  uint64_t  mask;
+  uint64_t  magic;
+  uint64_t* attacks;
+  int       shift;
+
+  inline unsigned index(const uint64_t occupied) const {
+#if defined(__BMI2__)
+    return unsigned(_pext_u64(occupied, mask));
+#else
+    return unsigned(((occupied & mask) * magic) >> shift);
+#endif
+  }
+};
+
+static uint64_t _BETWEEN[64][64];
+static uint64_t _LINE[64][64];
+static uint64_t _KING[64];
+static uint64_t _KNIGHT[64];
+static uint64_t _PAWN[2][64];
+static uint64_t _ROOK_TABLE[0x19000];
+static uint64_t _BISHOP_TABLE[0x1480];
+static Magic    _ROOK[64];
+static Magic    _BISHOP[64];
+static uint64_t _PIECE_KEY[2][6][64];
+static uint64_t _CASTLE_KEY[16];
+static uint64_t _EP_KEY[8];
+static uint64_t _DEPTH_KEY[256];
+static uint64_t _STM_KEY;
+static int      _CASTLE_MASK[64];
+
+//-----------------------------------------------------------------------------
+static inline uint64_t rookAttacks(const int sqr, const uint64_t occupied) {
+  return _ROOK[sqr].attacks[_ROOK[sqr].index(occupied)];
+}
+
+//-----------------------------------------------------------------------------
+static inline uint64_t bishopAttacks(const int sqr, const uint64_t occupied) {
+  return _BISHOP[sqr].attacks[_BISHOP[sqr].index(occupied)];
+}
+
+//-----------------------------------------------------------------------------
+//! \brief xorshift64* pseudo random number generator with a fixed seed
+//-----------------------------------------------------------------------------
+class Random {
+public:
+  explicit Random(const uint64_t seed) : state(seed) {}
+  uint64_t next() {
+    state ^= (state >> 12);
+    state ^= (state << 25);
+    state ^= (state >> 27);
+    return (state * 2685821657736338717ULL);
+  }
+  uint64_t sparse() {
+    return (next() & next() & next());
+  }
+private:
+  uint64_t state;
+};
+
+//-----------------------------------------------------------------------------
+static uint64_t slide(const int sqr, const uint64_t occupied,
+                      const int (*dirs)[2])
+{
+  uint64_t attacks = 0;
+  for (int d = 0; d < 4; ++d) {
+    int x = (sqr % 8) + dirs[d][0];
+    int y = (sqr / 8) + dirs[d][1];
+    for (; (x >= 0) && (x < 8) && (y >= 0) && (y < 8);
+         x += dirs[d][0], y += dirs[d][1])
+    {
+      attacks |= bit((y * 8) + x);
+      if (occupied & bit((y * 8) + x)) {
+        break;
+      }
+    }
+  }
+  return attacks;
+}
+
+//-----------------------------------------------------------------------------
+static void initMagics(Magic* magics, uint64_t* table, const int (*dirs)[2]) {
+  static const uint64_t RANK_EDGES = 0xFF000000000000FFULL;
+  static const uint64_t FILE_EDGES = 0x8181818181818181ULL;
+
+  uint64_t occupancy[4096];
+  uint64_t reference[4096];
+  int      epoch[4096] = {0};
+  int      attempt = 0;
+  Random   rng(728);
+
+  for (int sqr = 0; sqr < 64; ++sqr) {
+    const uint64_t edges = ((RANK_EDGES & ~(0xFFULL << ((sqr / 8) * 8))) |
+                            (FILE_EDGES & ~(0x0101010101010101ULL << (sqr % 8))));
+
+    Magic& m = magics[sqr];
+    m.mask = (slide(sqr, 0, dirs) & ~edges);
+    m.shift = (64 - popCount(m.mask));
+    m.attacks = ((sqr == 0) ? table : (magics[sqr - 1].attacks +
+                                       (1ULL << popCount(magics[sqr - 1].mask))));
+
+    // enumerate all subsets of mask (Carry-Rippler)
+    int size = 0;
+    uint64_t b = 0;
+    do {
+      occupancy[size] = b;
+      reference[size] = slide(sqr, b, dirs);
+#if defined(__BMI2__)
+      m.attacks[_pext_u64(b, m.mask)] = reference[size];
+#endif
+      size++;
+      b = ((b - m.mask) & m.mask);
+    } while (b);
+
+#if !defined(__BMI2__)
+    // find a magic number that maps every subset without destructive collision
+    for (int i = 0; i < size; ) {
+      for (m.magic = 0; popCount((m.magic * m.mask) >> 56) < 6; ) {
+        m.magic = rng.sparse();
+      }
+      for (++attempt, i = 0; i < size; ++i) {
+        const unsigned idx = m.index(occupancy[i]);
+        if (epoch[idx] < attempt) {
+          epoch[idx] = attempt;
+          m.attacks[idx] = reference[i];
+        }
+        else if (m.attacks[idx] != reference[i]) {
+          break;
+        }
+      }
+    }
+#else
+    (void)occupancy;
+    (void)epoch;
+    (void)attempt;
+    (void)rng;
+#endif
+  }
+}
+
+//-----------------------------------------------------------------------------
+static void initTables() {
+  static const int ROOK_DIRS[4][2]   = {{1,0},{-1,0},{0,1},{0,-1}};
+  static const int BISHOP_DIRS[4][2] = {{1,1},{1,-1},{-1,1},{-1,-1}};
+  static const int KNIGHT_DIRS[8][2] = {
+    {1,2},{2,1},{2,-1},{1,-2},{-1,-2},{-2,-1},{-2,1},{-1,2}
+  };
+  static const int KING_DIRS[8][2] = {
+    {1,0},{1,1},{0,1},{-1,1},{-1,0},{-1,-1},{0,-1},{1,-1}
+  };
+
+  initMagics(_ROOK, _ROOK_TABLE, ROOK_DIRS);
+  initMagics(_BISHOP, _BISHOP_TABLE, BISHOP_DIRS);
+
+  for (int sqr = 0; sqr < 64; ++sqr) {
+    const int x = (sqr % 8);
+    const int y = (sqr / 8);
+    for (int d = 0; d < 8; ++d) {
+      int nx = (x + KNIGHT_DIRS[d][0]);
+      int ny = (y + KNIGHT_DIRS[d][1]);
+      if ((nx >= 0) && (nx < 8) && (ny >= 0) && (ny < 8)) {
+        _KNIGHT[sqr] |= bit((ny * 8) + nx);
+      }
+      nx = (x + KING_DIRS[d][0]);
+      ny = (y + KING_DIRS[d][1]);
+      if ((nx >= 0) && (nx < 8) && (ny >= 0) && (ny < 8)) {
+        _KING[sqr] |= bit((ny * 8) + nx);
+      }
+    }
+    for (int dx = -1; dx <= 1; dx += 2) {
+      if (((x + dx) >= 0) && ((x + dx) < 8)) {
+        if (y < 7) _PAWN[White][sqr] |= bit(((y + 1) * 8) + x + dx);
+        if (y > 0) _PAWN[Black][sqr] |= bit(((y - 1) * 8) + x + dx);
+      }
+    }
+  }
+
+  for (int a = 0; a < 64; ++a) {
+    for (int b = 0; b < 64; ++b) {
+      if (a == b) {
+        continue;
+      }
+      if (rookAttacks(a, 0) & bit(b)) {
+        _BETWEEN[a][b] = (rookAttacks(a, bit(b)) & rookAttacks(b, bit(a)));
+        _LINE[a][b] = ((rookAttacks(a, 0) & rookAttacks(b, 0)) | bit(a) | bit(b));
+      }
+      else if (bishopAttacks(a, 0) & bit(b)) {
+        _BETWEEN[a][b] = (bishopAttacks(a, bit(b)) & bishopAttacks(b, bit(a)));
+        _LINE[a][b] = ((bishopAttacks(a, 0) & bishopAttacks(b, 0)) |
+                       bit(a) | bit(b));
+      }
+    }
+  }
+
+  Random rng(1070372);
+  for (int c = 0; c < 2; ++c) {
+    for (int p = 0; p < 6; ++p) {
+      for (int sqr = 0; sqr < 64; ++sqr) {
+        _PIECE_KEY[c][p][sqr] = rng.next();
+      }
+    }
+  }
+  for (int i = 0; i < 16; ++i) {
+    _CASTLE_KEY[i] = rng.next();
+  }
+  for (int i = 0; i < 8; ++i) {
+    _EP_KEY[i] = rng.next();
+  }
+  for (int i = 0; i < 256; ++i) {
+    _DEPTH_KEY[i] = rng.next();
+  }
+  _STM_KEY = rng.next();
+
+  for (int sqr = 0; sqr < 64; ++sqr) {
+    _CASTLE_MASK[sqr] = 0xF;
+  }
+  _CASTLE_MASK[0]  &= ~WhiteLong;
+  _CASTLE_MASK[4]  &= ~(WhiteShort | WhiteLong);
+  _CASTLE_MASK[7]  &= ~WhiteShort;
+  _CASTLE_MASK[56] &= ~BlackLong;
+  _CASTLE_MASK[60] &= ~(BlackShort | BlackLong);
+  _CASTLE_MASK[63] &= ~BlackShort;
+}
+
+//-----------------------------------------------------------------------------
+ReferenceBoard::ReferenceBoard(const size_t hashMB)
+  : stopFlag(nullptr)
+{
+  static std::once_flag initialized;
+  std::call_once(initialized, initTables);
+
+  if (hashMB) {
+    size_t entries = 1;
+    while ((entries * 2 * sizeof(HashEntry)) <= (hashMB * 1024 * 1024)) {
+      entries *= 2;
+    }
+    hashTable.resize(entries, HashEntry{0, 0});
+  }
+
+  loadFEN("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+}
+
+//-----------------------------------------------------------------------------
+bool ReferenceBoard::loadFEN(const std::string& fen, std::string* remain) {
+  static const std::string PIECES = "PNBRQK";
+
+  Position p;
+  memset(&p, 0, sizeof(p));
+  p.ep = -1;
+  p.moveNumber = 1;
+
+  std::stringstream ss(fen);
+  std::string placement;
+  std::string color;
+  std::string castle;
+  std::string ep;
+  if (!(ss >> placement >> color >> castle >> ep)) {
+    Output() << "Incomplete FEN string: " << fen;
+    return false;
+  }
+
+  int x = 0;
+  int y = 7;
+  for (const char ch : placement) {
+    if (ch == '/') {
+      if ((x != 8) || (--y < 0)) {
+        Output() << "Invalid piece placement: " << placement;
+        return false;
+      }
+      x = 0;
+    }
+    else if ((ch >= '1') && (ch <= '8')) {
+      x += (ch - '0');
+    }
+    else {
+      const size_t type = PIECES.find(static_cast<char>(toupper(ch)));
+      if ((type == std::string::npos) || (x > 7)) {
+        Output() << "Invalid piece placement: " << placement;
+        return false;
+      }
+      const int side = isupper(ch) ? White : Black;
+      p.pieces[side][type] |= bit((y * 8) + x);
+      p.occupied[side] |= bit((y * 8) + x);
+      p.key ^= _PIECE_KEY[side][type][(y * 8) + x];
+      x++;
+    }
+  }
+  if ((x != 8) || (y != 0) ||
+      (popCount(p.pieces[White][King]) != 1) ||
+      (popCount(p.pieces[Black][King]) != 1))
+  {
+    Output() << "Invalid piece placement: " << placement;
+    return false;
+  }
+
+  if ((color == "w") || (color == "W")) {
+    p.stm = White;
+  }
+  else if ((color == "b") || (color == "B")) {
+    p.stm = Black;
+    p.key ^= _STM_KEY;
+  }
+  else {
+    Output() << "Expected 'w' or 'b' at " << color;
+    return false;
+  }
+
+  for (const char ch : castle) {
+    switch (ch) {
+    case 'K': p.castle |= WhiteShort; break;
+    case 'Q': p.castle |= WhiteLong;  break;
+    case 'k': p.castle |= BlackShort; break;
+    case 'q': p.castle |= BlackLong;  break;
+    case '-': break;
+    default:
+      Output() << "Unexpected castle rights at " << castle;
+      return false;
+    }
+  }
+  if ((p.pieces[White][King] != bit(4)) ||
+      !(p.pieces[White][Rook] & bit(7))) p.castle &= ~WhiteShort;
+  if ((p.pieces[White][King] != bit(4)) ||
+      !(p.pieces[White][Rook] & bit(0))) p.castle &= ~WhiteLong;
+  if ((p.pieces[Black][King] != bit(60)) ||
+      !(p.pieces[Black][Rook] & bit(63))) p.castle &= ~BlackShort;
+  if ((p.pieces[Black][King] != bit(60)) ||
+      !(p.pieces[Black][Rook] & bit(56))) p.castle &= ~BlackLong;
+  p.key ^= _CASTLE_KEY[p.castle];
+
+  if ((ep.size() == 2) && (ep[0] >= 'a') && (ep[0] <= 'h') &&
+      (ep[1] == (p.stm ? '3' : '6')))
+  {
+    p.ep = (((ep[1] - '1') * 8) + (ep[0] - 'a'));
+    p.key ^= _EP_KEY[p.ep % 8];
+  }
+  else if (ep != "-") {
+    Output() << "Invalid en passant square: " << ep;
+    return false;
+  }
+
+  // optional half-move clock and full move number
+  std::streampos mark = ss.tellg();
+  int rule50 = 0;
+  int moveNumber = 0;
+  if ((ss >> rule50) && (ss >> moveNumber)) {
+    p.rule50 = rule50;
+    p.moveNumber = std::max<int>(1, moveNumber);
+    mark = ss.tellg();
+  }
+
+  if (attackers(p, lsb(p.pieces[!p.stm][King]), p.stm,
+                (p.occupied[White] | p.occupied[Black])))
+  {
+    Output() << "Side not to move is in check: " << fen;
+    return false;
+  }
+
+  pos = p;
+  if (remain) {
+    *remain = ((mark < 0) ? std::string() : trimLeft(fen.substr(size_t(mark))));
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+std::string ReferenceBoard::getFEN() const {
+  static const char PIECES[2][7] = { "PNBRQK", "pnbrqk" };
+
+  std::string fen;
+  for (int y = 7; y >= 0; --y) {
+    int empty = 0;
+    for (int x = 0; x < 8; ++x) {
+      const uint64_t sqr = bit((y * 8) + x);
+      char ch = 0;
+      for (int c = 0; !ch && (c < 2); ++c) {
+        for (int t = 0; !ch && (t < 6); ++t) {
+          if (pos.pieces[c][t] & sqr) {
+            ch = PIECES[c][t];
+          }
+        }
+      }
+      if (ch) {
+        if (empty) {
+          fen += static_cast<char>('0' + empty);
+          empty = 0;
+        }
+        fen += ch;
+      }
+      else {
+        empty++;
+      }
+    }
+    if (empty) {
+      fen += static_cast<char>('0' + empty);
+    }
+    if (y) {
+      fen += '/';
+    }
+  }
+
+  fen += (pos.stm ? " b " : " w ");
+  if (pos.castle & WhiteShort) fen += 'K';
+  if (pos.castle & WhiteLong)  fen += 'Q';
+  if (pos.castle & BlackShort) fen += 'k';
+  if (pos.castle & BlackLong)  fen += 'q';
+  if (!pos.castle) fen += '-';
+
+  if (pos.ep >= 0) {
+    fen += ' ';
+    fen += static_cast<char>('a' + (pos.ep % 8));
+    fen += static_cast<char>('1' + (pos.ep / 8));
+  }
+  else {
+    fen += " -";
+  }
+
+  fen += ' ' + std::to_string(pos.rule50);
+  fen += ' ' + std::to_string(pos.moveNumber);
+  return fen;
+}
+
+//-----------------------------------------------------------------------------
+bool ReferenceBoard::inCheck() const {
+  return attackers(pos, lsb(pos.pieces[pos.stm][King]), !pos.stm,
+                   (pos.occupied[White] | pos.occupied[Black])) != 0;
+}
+
+//-----------------------------------------------------------------------------
+std::list<std::string> ReferenceBoard::getMoves() const {
+  Move moves[256];
+  Move* end = generate(pos, moves);
+  std::list<std::string> result;
+  for (Move* mv = moves; mv < end; ++mv) {
+    result.push_back(moveString(*mv));
+  }
+  return result;
+}
+
+//-----------------------------------------------------------------------------
+bool ReferenceBoard::makeMove(const std::string& move) {
+  Move moves[256];
+  Move* end = generate(pos, moves);
+  for (Move* mv = moves; mv < end; ++mv) {
+    if (moveString(*mv) == move) {
+      exec(pos, *mv);
+      return true;
+    }
+  }
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+uint64_t ReferenceBoard::perft(const int depth) {
+  return (depth < 1) ? 1 : perft(pos, std::min<int>(depth, 255));
+}
+
+//-----------------------------------------------------------------------------
+uint64_t ReferenceBoard::perft(const Position& p, const int depth) {
+  Move moves[256];
+  Move* end = generate(p, moves);
+  if (depth <= 1) {
+    return uint64_t(end - moves);
+  }
+
+  if (stopFlag && stopFlag->load(std::memory_order_relaxed)) {
+    return 0;
+  }
+
+  const uint64_t key = (p.key ^ _DEPTH_KEY[depth]);
+  HashEntry* entry = nullptr;
+  if (hashTable.size()) {
+    entry = &hashTable[key & (hashTable.size() - 1)];
+    if (entry->key == key) {
+      return entry->count;
+    }
+  }
+
+  uint64_t count = 0;
+  for (Move* mv = moves; mv < end; ++mv) {
+    Position child = p;
+    exec(child, *mv);
+    count += perft(child, (depth - 1));
+  }
+
+  if (stopFlag && stopFlag->load(std::memory_order_relaxed)) {
+    return count; // incomplete, don't store it
+  }
+
+  if (entry) {
+    entry->key = key;
+    entry->count = count;
+  }
+  return count;
+}
+
+//-----------------------------------------------------------------------------
+uint64_t ReferenceBoard::attackers(const Position& p, const int sqr,
+                                   const int side, const uint64_t occupied)
+{
+  const uint64_t* pc = p.pieces[side];
+  return ((_PAWN[!side][sqr] & pc[Pawn]) |
+          (_KNIGHT[sqr] & pc[Knight]) |
+          (_KING[sqr] & pc[King]) |
+          (bishopAttacks(sqr, occupied) & (pc[Bishop] | pc[Queen])) |
+          (rookAttacks(sqr, occupied) & (pc[Rook] | pc[Queen])));
+}
+
+//-----------------------------------------------------------------------------
+std::string ReferenceBoard::moveString(const Move mv) {
+  static const char PROMO[] = " nbrq";
+  std::string str;
+  str += static_cast<char>('a' + (fromSqr(mv) % 8));
+  str += static_cast<char>('1' + (fromSqr(mv) / 8));
+  str += static_cast<char>('a' + (toSqr(mv) % 8));
+  str += static_cast<char>('1' + (toSqr(mv) / 8));
+  if (promoOf(mv)) {
+    str += PROMO[promoOf(mv)];
+  }
+  return str;
+}
+
+//-----------------------------------------------------------------------------
+static inline uint32_t* addPawnMoves(uint32_t* moves, const int from,
+                                     const int to)
+{
+  if ((to >= 56) || (to < 8)) {
+    *moves++ = toMove(from, to, Queen);
+    *moves++ = toMove(from, to, Rook);
+    *moves++ = toMove(from, to, Bishop);
+    *moves++ = toMove(from, to, Knight);
+  }
+  else {
+    *moves++ = toMove(from, to);
+  }
+  return moves;
+}
+
+//-----------------------------------------------------------------------------
+ReferenceBoard::Move* ReferenceBoard::generate(const Position& p, Move* moves) {
+  const int      us       = p.stm;
+  const int      them     = !us;
+  const uint64_t own      = p.occupied[us];
+  const uint64_t enemy    = p.occupied[them];
+  const uint64_t occupied = (own | enemy);
+  const int      king     = lsb(p.pieces[us][King]);
+  const uint64_t checkers = attackers(p, king, them, occupied);
+
+  // king moves (king removed from occupancy so it can't hide behind itself)
+  for (uint64_t bb = (_KING[king] & ~own); bb; ) {
+    const int to = popLsb(bb);
+    if (!attackers(p, to, them, (occupied ^ bit(king)))) {
+      *moves++ = toMove(king, to);
+    }
+  }
+
+  if (popCount(checkers) > 1) {
+    return moves;
+  }
+
+  // squares that resolve check (if any), otherwise anywhere not occupied by us
+  const uint64_t target = checkers
+      ? (_BETWEEN[king][lsb(checkers)] | checkers)
+      : ~own;
+
+  // pieces pinned against our king
+  uint64_t pinned = 0;
+  uint64_t snipers =
+      ((rookAttacks(king, 0) & (p.pieces[them][Rook] | p.pieces[them][Queen])) |
+       (bishopAttacks(king, 0) &
+        (p.pieces[them][Bishop] | p.pieces[them][Queen])));
+  while (snipers) {
+    const uint64_t blockers = (_BETWEEN[king][popLsb(snipers)] & occupied);
+    if ((popCount(blockers) == 1) && (blockers & own)) {
+      pinned |= blockers;
+    }
+  }
+
+  // castling
+  if (!checkers) {
+    if (us == White) {
+      if ((p.castle & WhiteShort) && !(occupied & 0x60ULL) &&
+          !attackers(p, 5, them, occupied) && !attackers(p, 6, them, occupied))
+      {
+        *moves++ = toMove(4, 6, 0, CastleMove);
+      }
+      if ((p.castle & WhiteLong) && !(occupied & 0x0EULL) &&
+          !attackers(p, 3, them, occupied) && !attackers(p, 2, them, occupied))
+      {
+        *moves++ = toMove(4, 2, 0, CastleMove);
+      }
+    }
+    else {
+      if ((p.castle & BlackShort) && !(occupied & (0x60ULL << 56)) &&
+          !attackers(p, 61, them, occupied) &&
+          !attackers(p, 62, them, occupied))
+      {
+        *moves++ = toMove(60, 62, 0, CastleMove);
+      }
+      if ((p.castle & BlackLong) && !(occupied & (0x0EULL << 56)) &&
+          !attackers(p, 59, them, occupied) &&
+          !attackers(p, 58, them, occupied))
+      {
+        *moves++ = toMove(60, 58, 0, CastleMove);
+      }
+    }
+  }
+
+  // knights (a pinned knight can never move)
+  for (uint64_t pcs = (p.pieces[us][Knight] & ~pinned); pcs; ) {
+    const int from = popLsb(pcs);
+    for (uint64_t bb = (_KNIGHT[from] & target); bb; ) {
+      *moves++ = toMove(from, popLsb(bb));
+    }
+  }
+
+  // sliders
+  const uint64_t diagonal = (p.pieces[us][Bishop] | p.pieces[us][Queen]);
+  const uint64_t straight = (p.pieces[us][Rook] | p.pieces[us][Queen]);
+  for (uint64_t pcs = diagonal; pcs; ) {
+    const int from = popLsb(pcs);
+    uint64_t bb = (bishopAttacks(from, occupied) & target);
+    if (pinned & bit(from)) {
+      bb &= _LINE[king][from];
+    }
+    while (bb) {
+      *moves++ = toMove(from, popLsb(bb));
+    }
+  }
+  for (uint64_t pcs = straight; pcs; ) {
+    const int from = popLsb(pcs);
+    uint64_t bb = (rookAttacks(from, occupied) & target);
+    if (pinned & bit(from)) {
+      bb &= _LINE[king][from];
+    }
+    while (bb) {
+      *moves++ = toMove(from, popLsb(bb));
+    }
+  }
+
+  // pawns
+  const int forward = (us == White) ? 8 : -8;
+  const uint64_t startRank = (us == White) ? 0xFF00ULL : (0xFF00ULL << 40);
+  for (uint64_t pcs = p.pieces[us][Pawn]; pcs; ) {
+    const int from = popLsb(pcs);
+    const uint64_t allowed = (pinned & bit(from))
+        ? (target & _LINE[king][from])
+        : target;
+
+    const int to = (from + forward);
+    if (!(occupied & bit(to))) {
+      if (allowed & bit(to)) {
+        moves = addPawnMoves(moves, from, to);
+      }
+      if ((startRank & bit(from)) && !(occupied & bit(to + forward)) &&
+          (allowed & bit(to + forward)))
+      {
+        *moves++ = toMove(from, (to + forward), 0, PawnLunge);
+      }
+    }
+
+    for (uint64_t bb = (_PAWN[us][from] & enemy & allowed); bb; ) {
+      moves = addPawnMoves(moves, from, popLsb(bb));
+    }
+
+    // en passant legality is verified the slow way, it's rare enough
+    if ((p.ep >= 0) && (_PAWN[us][from] & bit(p.ep))) {
+      Position child = p;
+      exec(child, toMove(from, p.ep, 0, PassantMove));
+      if (!attackers(child, king, them,
+                     (child.occupied[White] | child.occupied[Black])))
+      {
+        *moves++ = toMove(from, p.ep, 0, PassantMove);
+      }
+    }
+  }
+
+  return moves;
+}
+
+//-----------------------------------------------------------------------------
+void ReferenceBoard::exec(Position& p, const Move mv) {
+  const int us   = p.stm;
+  const int them = !us;
+  const int from = fromSqr(mv);
+  const int to   = toSqr(mv);
+  const int flag = flagOf(mv);
+
+  int type = Pawn;
+  while (!(p.pieces[us][type] & bit(from))) {
+    type++;
+  }
+
+  if (p.ep >= 0) {
+    p.key ^= _EP_KEY[p.ep % 8];
+    p.ep = -1;
+  }
+
+  p.rule50++;
+  if (type == Pawn) {
+    p.rule50 = 0;
+  }
+
+  // remove captured piece
+  const int capSqr = (flag == PassantMove) ? (to - ((us == White) ? 8 : -8)) : to;
+  if (p.occupied[them] & bit(capSqr)) {
+    int cap = Pawn;
+    while (!(p.pieces[them][cap] & bit(capSqr))) {
+      cap++;
+    }
+    p.pieces[them][cap] ^= bit(capSqr);
+    p.occupied[them] ^= bit(capSqr);
+    p.key ^= _PIECE_KEY[them][cap][capSqr];
+    p.rule50 = 0;
+  }
+
+  // move the piece, promote if necessary
+  const int promo = promoOf(mv);
+  p.pieces[us][type] ^= bit(from);
+  p.pieces[us][promo ? promo : type] ^= bit(to);
+  p.occupied[us] ^= (bit(from) | bit(to));
+  p.key ^= (_PIECE_KEY[us][type][from] ^
+            _PIECE_KEY[us][promo ? promo : type][to]);
+
+  if (flag == CastleMove) {
+    const int rookFrom = (to > from) ? (to + 1) : (to - 2);
+    const int rookTo = (to > from) ? (to - 1) : (to + 1);
+    p.pieces[us][Rook] ^= (bit(rookFrom) | bit(rookTo));
+    p.occupied[us] ^= (bit(rookFrom) | bit(rookTo));
+    p.key ^= (_PIECE_KEY[us][Rook][rookFrom] ^ _PIECE_KEY[us][Rook][rookTo]);
+  }
+  else if (flag == PawnLunge) {
+    p.ep = ((from + to) / 2);
+    p.key ^= _EP_KEY[p.ep % 8];
+  }
+
+  p.key ^= _CASTLE_KEY[p.castle];
+  p.castle &= (_CASTLE_MASK[from] & _CASTLE_MASK[to]);
+  p.key ^= _CASTLE_KEY[p.castle];
+
+  if (us == Black) {
+    p.moveNumber++;
+  }
+  p.stm = them;
+  p.key ^= _STM_KEY;
+}
+
+} // namespace senjo
@@ -0,0 +1,134 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2015-2019 Shawn Chidester <zd3nik@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef SENJO_REFERENCE_BOARD_H
+#define SENJO_REFERENCE_BOARD_H
+
+#include "Platform.h"
+#include <atomic>
+#include <vector>
+
+namespace senjo {
+
+//-----------------------------------------------------------------------------
+//! \brief Legal bitboard move generator used as a perft reference
+//! Sliding piece attacks use magic bitboards, or PEXT when compiled with BMI2
+//! support.  Perft results are cached in a hash table owned by each instance,
+//! so instances may be used concurrently on different threads.
+//-----------------------------------------------------------------------------
+class ReferenceBoard {
+public:
+  //--------------------------------------------------------------------------
+  //! \brief Constructor
+  //! \param[in] hashMB Size of the perft hash table in megabytes (0 = none)
+  //--------------------------------------------------------------------------
+  explicit ReferenceBoard(const size_t hashMB = 16);
+
+  //--------------------------------------------------------------------------
+  //! \brief Load board position from given FEN string
+  //! \param[in] fen The FEN string
+  //! \param[out] remain If not NULL populated with tail portion of \p fen
+  //!                    string that was not used to set the position.
+  //! \return true if \p fen is valid
+  //--------------------------------------------------------------------------
+  bool loadFEN(const std::string& fen, std::string* remain = nullptr);
+
+  //--------------------------------------------------------------------------
+  //! \brief Get a FEN string representation of the current board position
+  //! \return A FEN string representation of the current board postiion
+  //--------------------------------------------------------------------------
+  std::string getFEN() const;
+
+  //--------------------------------------------------------------------------
+  //! \brief Is it white to move in the current position?
+  //! \return true if it is white to move in the current position
+  //--------------------------------------------------------------------------
+  bool whiteToMove() const { return !pos.stm; }
+
+  //--------------------------------------------------------------------------
+  //! \brief Is the side to move in check?
+  //! \return true if the side to move is in check
+  //--------------------------------------------------------------------------
+  bool inCheck() const;
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the legal moves for the current position
+  //! \return Legal moves in coordinate notation (e.g. "e2e4", "e7f8q")
+  //--------------------------------------------------------------------------
+  std::list<std::string> getMoves() const;
+
+  //--------------------------------------------------------------------------
+  //! \brief Execute a single legal move on the current position
+  //! \param[in] move A string containing move coordinate notation
+  //! \return false if the given string isn't a legal move
+  //--------------------------------------------------------------------------
+  bool makeMove(const std::string& move);
+
+  //--------------------------------------------------------------------------
+  //! \brief Count leaf nodes of the legal move tree from the current position
+  //! \param[in] depth How many half-moves (plies) to search
+  //! \return The number of leaf nodes visited at \p depth
+  //--------------------------------------------------------------------------
+  uint64_t perft(const int depth);
+
+  //--------------------------------------------------------------------------
+  //! \brief Set the flag that tells perft() to exit as quickly as possible
+  //! The leaf count returned by a stopped perft() is incomplete.
+  //! \param[in] flag Pointer to the stop flag, nullptr to clear
+  //--------------------------------------------------------------------------
+  void setStopFlag(const std::atomic<bool>* flag) { stopFlag = flag; }
+
+private:
+  typedef uint32_t Move;
+
+  struct Position {
+    uint64_t pieces[2][6];
+    uint64_t occupied[2];
+    uint64_t key;
+    int      stm;
+    int      castle;
+    int      ep;
+    int      rule50;
+    int      moveNumber;
+  };
+
+  struct HashEntry {
+    uint64_t key;
+    uint64_t count;
+  };
+
+  static Move* generate(const Position&, Move* moves);
+  static void exec(Position&, const Move);
+  static uint64_t attackers(const Position&, const int sqr, const int side,
+                            const uint64_t occupied);
+  static std::string moveString(const Move);
+
+  uint64_t perft(const Position&, const int depth);
+
+  Position pos;
+  std::vector<HashEntry> hashTable;
+  const std::atomic<bool>* stopFlag;
+};
+
+} // namespace senjo
+
+#endif // SENJO_REFERENCE_BOARD_H
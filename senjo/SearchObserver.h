@@ -0,0 +1,69 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2019 Shawn Chidester <zd3nik@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//-----------------------------------------------------------------------------
+
+
+#ifndef SENJO_SEARCH_OBSERVER_H
+#define SENJO_SEARCH_OBSERVER_H
+
+#include "InfoLine.h"
+#include "SearchStats.h"
+
+namespace senjo {
+
+//-----------------------------------------------------------------------------
+//! \brief Receives notifications about a search in progress
+//! Batch commands such as "test" attach an observer to an engine with
+//! ChessEngine::setSearchObserver() before calling go().  Notifications are
+//! delivered on the searching thread, so implementations must be quick.
+//-----------------------------------------------------------------------------
+class SearchObserver {
+public:
+  virtual ~SearchObserver() {}
+
+  //--------------------------------------------------------------------------
+  //! \brief The engine's best move changed
+  //! \param[in] move The new best move in coordinate notation
+  //! \param[in] stats Search statistics at the time of the change
+  //--------------------------------------------------------------------------
+  virtual void bestMoveChanged(const std::string& move,
+                               const SearchStats& stats) = 0;
+
+  //--------------------------------------------------------------------------
+  //! \brief The engine completed a search iteration
+  //! \param[in] move The best move at the end of the iteration
+  //! \param[in] stats Search statistics at the end of the iteration
+  //--------------------------------------------------------------------------
+  virtual void iterationComplete(const std::string& /*move*/,
+                                 const SearchStats& /*stats*/)
+  {
+  }
+
+  //--------------------------------------------------------------------------
+  //! \brief The engine reported search progress with reportInfo()
+  //! \param[in] info The reported info line, before it is written
+  //--------------------------------------------------------------------------
+  virtual void infoReported(const InfoLine& /*info*/) { }
+};
+
+} // namespace senjo
+
+#endif // SENJO_SEARCH_OBSERVER_H
@@ -23,6 +23,7 @@
 #ifndef SENJO_SEARCH_STATS_H
 #define SENJO_SEARCH_STATS_H
 
+#include "LineFormatter.h"
 #include "Platform.h"
 
 namespace senjo {
@@ -34,6 +35,14 @@ struct SearchStats {
   uint64_t nodes    = 0; // The number of nodes searched so far
   uint64_t qnodes   = 0; // The number of quiescence nodes searched so far
   uint64_t msecs    = 0; // The number of milliseconds spent searching so far
+
+  // Nodes per second, computed without floating point math
+  uint64_t nps() const {
+    if (!msecs) {
+      return 0;
+    }
+    return (((nodes / msecs) * 1000) + (((nodes % msecs) * 1000) / msecs));
+  }
 };
 
 //-----------------------------------------------------------------------------
@@ -42,10 +51,22 @@ inline std::ostream& operator<<(std::ostream& os, const SearchStats& stats) {
      << " seldepth " << stats.seldepth
      << " nodes " << stats.nodes
      << " time " << stats.msecs
-     << " nps " << static_cast<uint64_t>(rate(stats.nodes, stats.msecs));
+     << " nps " << stats.nps();
   return os;
 }
 
+//-----------------------------------------------------------------------------
+inline LineFormatter& operator<<(LineFormatter& line,
+                                 const SearchStats& stats)
+{
+  line << "depth " << stats.depth
+       << " seldepth " << stats.seldepth
+       << " nodes " << stats.nodes
+       << " time " << stats.msecs
+       << " nps " << stats.nps();
+  return line;
+}
+
 } // namespace senjo
 
 #endif // SENJO_SEARCH_STATS_H
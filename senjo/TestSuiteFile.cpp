@@ -0,0 +1,246 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2019 Shawn Chidester <zd3nik@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//-----------------------------------------------------------------------------
+
+
+#include "TestSuiteFile.h"
+#include "EpdFile.h"
+#include "Output.h"
+#include "Parameters.h"
+#include <fstream>
+#include <vector>
+
+namespace senjo {
+
+//-----------------------------------------------------------------------------
+const char TestSuiteFile::_MAGIC[8] = {
+  'S', 'E', 'N', 'J', 'O', 'T', 'S', '1'
+};
+
+//-----------------------------------------------------------------------------
+static void putInt(std::string& out, uint64_t value, const size_t bytes) {
+  for (size_t i = 0; i < bytes; ++i, value >>= 8) {
+    out += static_cast<char>(value & 0xFF);
+  }
+}
+
+//-----------------------------------------------------------------------------
+static uint64_t getInt(const char* p, const size_t bytes) {
+  uint64_t value = 0;
+  for (size_t i = bytes; i > 0; --i) {
+    value = ((value << 8) | static_cast<unsigned char>(p[i - 1]));
+  }
+  return value;
+}
+
+//-----------------------------------------------------------------------------
+bool TestSuiteFile::isSuiteFile(const std::string& fileName) {
+  char magic[sizeof(_MAGIC)];
+  std::ifstream fs(fileName, std::ios::in | std::ios::binary);
+  return (fs.read(magic, sizeof(magic)) &&
+          !memcmp(magic, _MAGIC, sizeof(_MAGIC)));
+}
+
+//-----------------------------------------------------------------------------
+bool TestSuiteFile::compile(const std::string& epdFileName,
+                            const std::string& outFileName)
+{
+  EpdFile epdFile;
+  if (!epdFile.open(epdFileName)) {
+    return false;
+  }
+
+  MoveFinder moveFinder;
+  std::string records;
+  std::vector<uint64_t> offsets;
+  const uint64_t start = (_HEADER_SIZE + (8 * epdFile.size()));
+
+  for (size_t i = 0; i < epdFile.size(); ++i) {
+    const EpdFile::Record record = epdFile[i];
+    const std::string text(record.text);
+    const std::string fen = EpdFile::getFEN(record.text);
+    if (!moveFinder.loadFEN(fen)) {
+      Output() << "error at line " << record.line << ", invalid FEN";
+      return false;
+    }
+
+    std::set<std::string> best;
+    std::set<std::string> avoid;
+    getSolutions(moveFinder, text, best, avoid);
+    if (avoid.empty() && best.empty()) {
+      Output() << "error at line " << record.line
+               << ", no best or avoid moves specified";
+      return false;
+    }
+
+    if ((text.size() > 0xFFFF) || (best.size() > 0xFF) ||
+        (avoid.size() > 0xFF))
+    {
+      Output() << "error at line " << record.line << ", record too large";
+      return false;
+    }
+
+    offsets.push_back(start + records.size());
+    putInt(records, uint64_t(record.line), 4);
+    putInt(records, text.size(), 2);
+    putInt(records, fen.size(), 2);
+    putInt(records, best.size(), 1);
+    putInt(records, avoid.size(), 1);
+    records += text;
+    records += fen;
+    for (const std::set<std::string>* moves : { &best, &avoid }) {
+      for (const std::string& move : *moves) {
+        records += move;
+        records.append((MOVE_SIZE - move.size()), '\0');
+      }
+    }
+  }
+
+  std::string header(_MAGIC, sizeof(_MAGIC));
+  putInt(header, offsets.size(), 4);
+  putInt(header, 0, 4);
+  for (const uint64_t offset : offsets) {
+    putInt(header, offset, 8);
+  }
+
+  std::ofstream out(outFileName, std::ios::out | std::ios::binary |
+                                 std::ios::trunc);
+  out.write(header.data(), std::streamsize(header.size()));
+  out.write(records.data(), std::streamsize(records.size()));
+  out.close();
+  if (!out) {
+    Output() << "Cannot write " << outFileName;
+    return false;
+  }
+
+  Output() << "Compiled " << offsets.size() << " test positions from "
+           << epdFileName << " to " << outFileName;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void TestSuiteFile::getSolutions(const MoveFinder& finder,
+                                 const std::string& epd,
+                                 std::set<std::string>& best,
+                                 std::set<std::string>& avoid)
+{
+  // consume 'am' and 'bm' parameters
+  Parameters params(epd);
+  while (params.size()) {
+    if (params.popParam("am")) {
+      while (params.size()) {
+        std::string coord = finder.toCoordinates(params.front());
+        if (coord.size()) {
+          params.pop_front();
+          avoid.insert(coord);
+        }
+        else {
+          break;
+        }
+      }
+    }
+    else if (params.popParam("bm")) {
+      while (params.size()) {
+        std::string coord = finder.toCoordinates(params.front());
+        if (coord.size()) {
+          params.pop_front();
+          best.insert(coord);
+        }
+        else {
+          break;
+        }
+      }
+    }
+    else {
+      params.pop_front();
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+bool TestSuiteFile::open(const std::string& fileName) {
+  close();
+  if (!file.open(fileName)) {
+    return false;
+  }
+
+  const char* data = file.data();
+  const size_t size = file.size();
+  if ((size < _HEADER_SIZE) || memcmp(data, _MAGIC, sizeof(_MAGIC))) {
+    Output() << fileName << " is not a compiled test suite";
+    close();
+    return false;
+  }
+
+  // verify every record is within the file so operator[] needn't check
+  const size_t records = size_t(getInt(data + sizeof(_MAGIC), 4));
+  if ((_HEADER_SIZE + (8 * records)) > size) {
+    Output() << fileName << " is truncated";
+    close();
+    return false;
+  }
+  for (size_t i = 0; i < records; ++i) {
+    const uint64_t offset = getInt(data + _HEADER_SIZE + (8 * i), 8);
+    if ((offset + _RECORD_HEADER_SIZE) > size) {
+      Output() << fileName << " is truncated";
+      close();
+      return false;
+    }
+    const char* p = (data + offset);
+    const uint64_t moves = (getInt(p + 8, 1) + getInt(p + 9, 1));
+    const uint64_t length = (_RECORD_HEADER_SIZE + getInt(p + 4, 2) +
+                             getInt(p + 6, 2) + (MOVE_SIZE * moves));
+    if ((offset + length) > size) {
+      Output() << fileName << " is truncated";
+      close();
+      return false;
+    }
+  }
+
+  count = records;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void TestSuiteFile::close() {
+  file.close();
+  count = 0;
+}
+
+//-----------------------------------------------------------------------------
+TestSuiteFile::Record TestSuiteFile::operator[](const size_t i) const {
+  const char* data = file.data();
+  const char* p = (data + getInt(data + _HEADER_SIZE + (8 * i), 8));
+  const size_t textLength = size_t(getInt(p + 4, 2));
+  const size_t fenLength = size_t(getInt(p + 6, 2));
+  const char* text = (p + _RECORD_HEADER_SIZE);
+
+  Record record;
+  record.line = int(getInt(p, 4));
+  record.text = std::string_view(text, textLength);
+  record.fen = std::string_view((text + textLength), fenLength);
+  record.bestCount = int(getInt(p + 8, 1));
+  record.avoidCount = int(getInt(p + 9, 1));
+  record.moves = (text + textLength + fenLength);
+  return record;
+}
+
+} // namespace senjo
@@ -0,0 +1,149 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2019 Shawn Chidester <zd3nik@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//-----------------------------------------------------------------------------
+
+
+#ifndef SENJO_TEST_SUITE_FILE_H
+#define SENJO_TEST_SUITE_FILE_H
+
+#include "MappedFile.h"
+#include "MoveFinder.h"
+#include <set>
+#include <string_view>
+
+namespace senjo {
+
+//-----------------------------------------------------------------------------
+//! \brief Compiled (binary) test suite
+//! A compiled test suite contains every record of an EPD test suite along
+//! with its FEN and the "bm" and "am" moves already converted to coordinate
+//! notation, so running the suite doesn't require any SAN move resolution.
+//! The file is memory mapped, records are accessed in constant time.
+//!
+//! File layout (all integers are little-endian):
+//!   char[8]  magic "SENJOTS1"
+//!   uint32   record count
+//!   uint32   reserved (0)
+//!   uint64   record offset, one per record
+//!   records, each:
+//!     uint32 line number in the source EPD file
+//!     uint16 EPD text length
+//!     uint16 FEN length
+//!     uint8  bm move count
+//!     uint8  am move count
+//!     EPD text, FEN, then 5 bytes per move ('\0' padded)
+//-----------------------------------------------------------------------------
+class TestSuiteFile {
+public:
+  static const size_t MOVE_SIZE = 5;
+
+  struct Record {
+    int              line;       ///< Line number in the source EPD file
+    std::string_view text;       ///< Source EPD text
+    std::string_view fen;        ///< FEN string
+    int              bestCount;  ///< Number of "bm" moves
+    int              avoidCount; ///< Number of "am" moves
+    const char*      moves;      ///< "bm" moves followed by "am" moves
+
+    std::string_view bestMove(const int i) const {
+      return move(i);
+    }
+    std::string_view avoidMove(const int i) const {
+      return move(bestCount + i);
+    }
+
+  private:
+    std::string_view move(const int i) const {
+      const char* p = (moves + (i * MOVE_SIZE));
+      return std::string_view(p, strnlen(p, MOVE_SIZE));
+    }
+  };
+
+  //--------------------------------------------------------------------------
+  //! \brief Is the given file a compiled test suite?
+  //! \param[in] fileName Path to the file
+  //! \return true if \p fileName begins with the compiled test suite magic
+  //--------------------------------------------------------------------------
+  static bool isSuiteFile(const std::string& fileName);
+
+  //--------------------------------------------------------------------------
+  //! \brief Compile an EPD test suite
+  //! \param[in] epdFileName Path to the EPD test suite
+  //! \param[in] outFileName Path to the compiled test suite to create
+  //! \return false if any record is invalid or the output can't be written
+  //--------------------------------------------------------------------------
+  static bool compile(const std::string& epdFileName,
+                      const std::string& outFileName);
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the "bm" and "am" moves of an EPD record in coordinate notation
+  //! \param[in] finder MoveFinder loaded with the record's position
+  //! \param[in] epd The EPD record, or the part of it following the FEN
+  //! \param[out] best Populated with the "bm" moves
+  //! \param[out] avoid Populated with the "am" moves
+  //--------------------------------------------------------------------------
+  static void getSolutions(const MoveFinder& finder, const std::string& epd,
+                           std::set<std::string>& best,
+                           std::set<std::string>& avoid);
+
+  //--------------------------------------------------------------------------
+  //! \brief Map the given compiled test suite into memory
+  //! \param[in] fileName Path to the compiled test suite
+  //! \return false if the file can't be mapped or is not a valid test suite
+  //--------------------------------------------------------------------------
+  bool open(const std::string& fileName);
+
+  //--------------------------------------------------------------------------
+  //! \brief Unmap the file, all record data is invalid after this call
+  //--------------------------------------------------------------------------
+  void close();
+
+  //--------------------------------------------------------------------------
+  //! \brief Is a compiled test suite open?
+  //! \return true if open() succeeded and close() has not been called
+  //--------------------------------------------------------------------------
+  bool isOpen() const { return (file.data() != nullptr); }
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the number of records in the test suite
+  //! \return The number of records in the test suite
+  //--------------------------------------------------------------------------
+  size_t size() const { return count; }
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the record at the given index
+  //! \param[in] i The record index, 0 through size() - 1
+  //! \return The record at index \p i
+  //--------------------------------------------------------------------------
+  Record operator[](const size_t i) const;
+
+private:
+  static const char _MAGIC[8];
+  static const size_t _HEADER_SIZE = 16;
+  static const size_t _RECORD_HEADER_SIZE = 10;
+
+  MappedFile file;
+  size_t count = 0;
+};
+
+} // namespace senjo
+
+#endif // SENJO_TEST_SUITE_FILE_H
@@ -27,7 +27,8 @@ namespace senjo {
 
 //-----------------------------------------------------------------------------
 Thread::Thread(int id)
-  : id(id)
+  : id(id),
+    sink(nullptr)
 {}
 
 //-----------------------------------------------------------------------------
@@ -42,6 +43,7 @@ bool Thread::run() {
     return false;
   }
 
+  sink = &OutputSink::current();
   thread.reset(new std::thread(Thread::staticRun, this));
   return true;
 }
@@ -63,6 +65,7 @@ void Thread::waitForFinish() {
 //-----------------------------------------------------------------------------
 void Thread::staticRun(Thread* thread) {
   if (thread) {
+    OutputSink::Scope scope(*thread->sink);
     try {
       thread->doWork();
     } catch (const std::exception& ex) {
@@ -28,8 +28,12 @@
 
 namespace senjo {
 
+class OutputSink;
+
 //-----------------------------------------------------------------------------
 //! \brief Base class for a single background task.
+//! Output from the task goes to the OutputSink that was current for the
+//! thread that called run().
 //-----------------------------------------------------------------------------
 class Thread {
 protected:
@@ -92,6 +96,7 @@ public:
 private:
   static void staticRun(Thread*);
   int id;
+  OutputSink* sink;
 };
 
 } // namespace senjo
@@ -0,0 +1,191 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2019 Shawn Chidester <zd3nik@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef SENJO_TOKEN_CURSOR_H
+#define SENJO_TOKEN_CURSOR_H
+
+#include "Platform.h"
+#include <charconv>
+#include <string_view>
+#include <type_traits>
+
+namespace senjo {
+
+//-----------------------------------------------------------------------------
+//! \brief Convert an entire string to a number without allocating memory
+//! For integer types a fractional part is ignored, e.g. "1000.5" is 1000,
+//! as it was when numbers were read with std::istream.
+//! \param[in] str The string to convert, e.g. "42", "+42", or "42.0"
+//! \param[out] value Set to the converted number, unchanged on failure
+//! \return true if all of \p str was converted
+//-----------------------------------------------------------------------------
+template<typename T>
+inline bool parseNumber(std::string_view str, T& value) {
+  if ((str.size() > 1) && (str[0] == '+')) {
+    str.remove_prefix(1);
+  }
+  if constexpr (std::is_integral<T>::value) {
+    const size_t dot = str.find('.');
+    if ((dot != std::string_view::npos) && (dot > 0) &&
+        (str.find_first_not_of("0123456789", (dot + 1)) ==
+         std::string_view::npos))
+    {
+      str = str.substr(0, dot);
+    }
+  }
+  const char* end = (str.data() + str.size());
+  T number;
+  const std::from_chars_result result =
+      std::from_chars(str.data(), end, number);
+  if ((result.ec != std::errc()) || (result.ptr != end)) {
+    return false;
+  }
+  value = number;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+//! \brief Whitespace delimited tokens of a string, without copying
+//! Tokens are returned as views into the string given to the constructor,
+//! so that string must outlive the cursor and every token taken from it.
+//! Whitespace is the same set of characters std::istream uses, so the
+//! tokens are the same as reading the string with >> one word at a time.
+//!
+//! Example:
+//!
+//!   TokenCursor tokens(line);
+//!   if (tokens.nextIs("depth")) {
+//!     tokens.next();
+//!     tokens.nextNumber(depth);
+//!   }
+//-----------------------------------------------------------------------------
+class TokenCursor {
+public:
+  TokenCursor() = default;
+
+  //--------------------------------------------------------------------------
+  //! \brief Constructor
+  //! \param[in] str The string to tokenize
+  //--------------------------------------------------------------------------
+  explicit TokenCursor(const std::string_view str)
+    : text(str)
+  {
+    skipSpace();
+  }
+
+  //--------------------------------------------------------------------------
+  //! \brief Are there no more tokens?
+  //! \return true if all tokens have been consumed
+  //--------------------------------------------------------------------------
+  bool empty() const {
+    return text.empty();
+  }
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the next token without consuming it
+  //! \return The next token, empty if there are no more tokens
+  //--------------------------------------------------------------------------
+  std::string_view peek() const {
+    return text.substr(0, tokenLength());
+  }
+
+  //--------------------------------------------------------------------------
+  //! \brief Consume the next token
+  //! \return The consumed token, empty if there are no more tokens
+  //--------------------------------------------------------------------------
+  std::string_view next() {
+    const std::string_view token = peek();
+    text.remove_prefix(token.size());
+    skipSpace();
+    return token;
+  }
+
+  //--------------------------------------------------------------------------
+  //! \brief Does the next token equal \p str, ignoring case?
+  //! \param[in] str The string to compare with
+  //! \return true if the next token equals \p str
+  //--------------------------------------------------------------------------
+  bool nextIs(const std::string_view str) const {
+    return (!empty() && iEqual(str, peek()));
+  }
+
+  //--------------------------------------------------------------------------
+  //! \brief Consume the next token if it equals \p str, ignoring case
+  //! \param[in] str The string to compare with
+  //! \return true if the next token was consumed
+  //--------------------------------------------------------------------------
+  bool skip(const std::string_view str) {
+    if (nextIs(str)) {
+      next();
+      return true;
+    }
+    return false;
+  }
+
+  //--------------------------------------------------------------------------
+  //! \brief Consume the next token if it is a number
+  //! \param[out] value Set to the number, unchanged if the next token isn't
+  //! \return true if the next token was a number and was consumed
+  //--------------------------------------------------------------------------
+  template<typename T>
+  bool nextNumber(T& value) {
+    if (!empty() && parseNumber(peek(), value)) {
+      next();
+      return true;
+    }
+    return false;
+  }
+
+  //--------------------------------------------------------------------------
+  //! \brief Get all remaining tokens without consuming them
+  //! \return Remaining text, starting at the next token
+  //--------------------------------------------------------------------------
+  std::string_view rest() const {
+    return text;
+  }
+
+private:
+  static bool isSpace(const char ch) {
+    return (ch == ' ') || (ch == '\t') || (ch == '\n') ||
+           (ch == '\r') || (ch == '\v') || (ch == '\f');
+  }
+
+  size_t tokenLength() const {
+    size_t len = 0;
+    while ((len < text.size()) && !isSpace(text[len])) {
+      ++len;
+    }
+    return len;
+  }
+
+  void skipSpace() {
+    while (!text.empty() && isSpace(text.front())) {
+      text.remove_prefix(1);
+    }
+  }
+
+  std::string_view text;
+};
+
+} // namespace senjo
+
+#endif // SENJO_TOKEN_CURSOR_H
@@ -22,11 +22,23 @@
 
 #include "UCIAdapter.h"
 #include "Output.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+
+#ifdef WIN32
+#include <io.h>
+#else
+#include <cerrno>
+#include <unistd.h>
+#endif
 
 namespace senjo {
 
 //-----------------------------------------------------------------------------
 namespace token {
+  static const std::string Bench("bench");
   static const std::string Debug("debug");
   static const std::string Exit("exit");
   static const std::string Fen("fen");
@@ -47,19 +59,153 @@ namespace token {
   static const std::string StartPos("startpos");
   static const std::string Stop("stop");
   static const std::string Test("test");
+  static const std::string Throttle("throttle");
   static const std::string Uci("uci");
   static const std::string UciNewGame("ucinewgame");
   static const std::string Value("value");
 }
 
 //-----------------------------------------------------------------------------
-UCIAdapter::UCIAdapter(ChessEngine& chessEngine)
-  : engine(chessEngine) {}
+UCIAdapter::UCIAdapter(ChessEngine& chessEngine,
+                       std::shared_ptr<OutputSink> outputSink)
+  : engine(chessEngine),
+    sink(outputSink ? outputSink : OutputSink::standardOutput())
+{
+  typedef std::unique_ptr<BackgroundCommand> Handle;
+
+  addCommand(token::Go, StopsSearch, [this](Parameters& params) {
+    execute(Handle(new GoCommandHandle(engine, &stopLatency)), params);
+    return true;
+  });
+  addCommand(token::Position, StopsSearch,
+             [this](const std::string_view line, TokenCursor& args) {
+    doPositionCommand(line, args);
+    return true;
+  });
+  addCommand(token::Stop, NoFlags,
+             [this](const std::string_view /*line*/, TokenCursor& args) {
+    doStopCommand(args);
+    return true;
+  });
+  addCommand(token::SetOption, NoFlags, [this](Parameters& params) {
+    doSetOptionCommand(params);
+    return true;
+  });
+  addCommand(token::IsReady, NoFlags,
+             [this](const std::string_view /*line*/, TokenCursor& args) {
+    doIsReadyCommand(args);
+    return true;
+  });
+  addCommand(token::Uci, NoFlags, [this](Parameters& params) {
+    doUCICommand(params);
+    return true;
+  });
+  addCommand(token::UciNewGame, StopsSearch, [this](Parameters& params) {
+    doUCINewGameCommand(params);
+    return true;
+  });
+  addCommand(token::New, StopsSearch, [this](Parameters& params) {
+    doNewCommand(params);
+    return true;
+  });
+  addCommand(token::Debug, NoFlags, [this](Parameters& params) {
+    doDebugCommand(params);
+    return true;
+  });
+  addCommand(token::Register, StopsSearch, [this](Parameters& params) {
+    execute(Handle(new RegisterCommandHandle(engine)), params);
+    return true;
+  });
+  addCommand(token::PonderHit, NoFlags,
+             [this](const std::string_view /*line*/, TokenCursor& args) {
+    doPonderHitCommand(args);
+    return true;
+  });
+  addCommand(token::Fen, NoFlags, [this](Parameters& params) {
+    doFENCommand(params);
+    return true;
+  });
+  addCommand(token::Print, NoFlags, [this](Parameters& params) {
+    doPrintCommand(params);
+    return true;
+  });
+  addCommand(token::Perft, StopsSearch, [this](Parameters& params) {
+    execute(Handle(new PerftCommandHandle(engine)), params);
+    return true;
+  });
+  addCommand(token::Test, StopsSearch, [this](Parameters& params) {
+    execute(Handle(new TestCommandHandle(engine)), params);
+    return true;
+  });
+  addCommand(token::Bench, StopsSearch, [this](Parameters& params) {
+    execute(Handle(new BenchCommandHandle(engine)), params);
+    return true;
+  });
+  addCommand(token::Opts, NoFlags, [this](Parameters& params) {
+    doOptsCommand(params);
+    return true;
+  });
+  addCommand(token::Throttle, NoFlags, [this](Parameters& params) {
+    doThrottleCommand(params);
+    return true;
+  });
+  addCommand(token::Help, NoFlags, [this](Parameters& params) {
+    doHelpCommand(params);
+    return true;
+  });
+
+  const ParamsDispatch quit = [this](Parameters& params) {
+    return !doQuitCommand(params);
+  };
+  addCommand(token::Exit, NoFlags, quit);
+  addCommand(token::Quit, NoFlags, quit);
+}
+
+//-----------------------------------------------------------------------------
+void UCIAdapter::addCommand(const std::string& name, const int flags,
+                            const Dispatch& dispatch, const bool custom)
+{
+  commands[toLower(name)] = Command{dispatch, flags, custom};
+}
 
 //-----------------------------------------------------------------------------
-bool UCIAdapter::doCommand(const std::string& line) {
-  Parameters params(line);
-  if (params.empty()) {
+void UCIAdapter::addCommand(const std::string& name, const int flags,
+                            const ParamsDispatch& dispatch, const bool custom)
+{
+  addCommand(name, flags,
+             [dispatch](const std::string_view /*line*/, TokenCursor& args) {
+    Parameters params(args.rest());
+    return dispatch(params);
+  }, custom);
+}
+
+//-----------------------------------------------------------------------------
+void UCIAdapter::registerCommand(const std::string& name,
+                                 const CommandHandler& handler,
+                                 const int flags)
+{
+  if (flags & Background) {
+    addCommand(name, flags, [this, name, handler](Parameters& params) {
+      execute(std::unique_ptr<BackgroundCommand>(
+                new CustomCommandHandle(engine, name, handler)), params);
+      return true;
+    }, true);
+  }
+  else {
+    addCommand(name, flags,
+               [handler](Parameters& params) {
+      handler(params);
+      return true;
+    }, true);
+  }
+}
+
+//-----------------------------------------------------------------------------
+bool UCIAdapter::doCommand(const std::string_view line) {
+  OutputSink::Scope scope(*sink);
+  commandFailed = false;
+  TokenCursor args(line);
+  if (args.empty()) {
     return true; // ignore empty lines
   }
 
@@ -67,82 +213,244 @@ bool UCIAdapter::doCommand(const std::string& line) {
     Output() << "received command: " << line;
   }
 
-  std::string command = params.popString();
-  if (iEqual(token::Go, command)) {
-    doStopCommand();
-    execute(std::unique_ptr<BackgroundCommand>(new GoCommandHandle(engine)), params);
-  }
-  else if (iEqual(token::Position, command)) {
-    doStopCommand();
-    doPositionCommand(line, params);
-  }
-  else if (iEqual(token::Stop, command)) {
-    doStopCommand(params);
-  }
-  else if (iEqual(token::SetOption, command)) {
-    doSetOptionCommand(params);
-  }
-  else if (iEqual(token::IsReady, command)) {
-    doIsReadyCommand(params);
-  }
-  else if (iEqual(token::Uci, command)) {
-    doUCICommand(params);
+  const std::string_view command = args.next();
+  auto it = commands.find(toLower(command));
+  if (it != commands.end()) {
+    const Command& cmd = it->second;
+    if (cmd.flags & StopsSearch) {
+      doStopCommand();
+    }
+    if ((cmd.flags & NeedsInit) && !engine.isInitialized()) {
+      engine.initialize();
+    }
+    return cmd.dispatch(line, args);
   }
-  else if (iEqual(token::UciNewGame, command)) {
+  else if (isMove(command)) {
     doStopCommand();
-    doUCINewGameCommand(params);
+    Parameters params(line);
+    doMoveCommand(params);
   }
-  else if (iEqual(token::New, command)) {
-    doStopCommand();
-    doNewCommand(params);
+  else {
+    Output() << "Unknown command: '" << command << "'";
+    Output() << "Enter 'help' for a list of commands";
+    commandFailed = true;
   }
-  else if (iEqual(token::Debug, command)) {
-    doDebugCommand(params);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+int UCIAdapter::runCommandLine(const int argc, const char* const argv[]) {
+  std::string line;
+  for (int i = 1; i < argc; ++i) {
+    line += (line.empty() ? "" : " ") + std::string(argv[i]);
   }
-  else if (iEqual(token::Register, command)) {
-    doStopCommand(params);
-    execute(std::unique_ptr<BackgroundCommand>(new RegisterCommandHandle(engine)), params);
+
+  if (lastCommand) {
+    lastCommand->stop();
+    lastCommand->waitForFinish();
+    std::lock_guard<std::mutex> lock(commandMutex);
+    lastCommand.reset();
   }
-  else if (iEqual(token::PonderHit, command)) {
-    doPonderHitCommand(params);
+
+  doCommand(line);
+  int status = commandFailed ? 1 : 0;
+  if (lastCommand && !commandFailed) {
+    lastCommand->waitForFinish();
+    status = lastCommand->succeeded() ? 0 : 1;
   }
-  else if (iEqual(token::Fen, command)) {
-    doFENCommand(params);
+
+  // don't lose output still queued for an asynchronous sink
+  sink->flush();
+  return status;
+}
+
+//-----------------------------------------------------------------------------
+//! \brief Executes the commands read by UCIAdapter::run() in order
+//-----------------------------------------------------------------------------
+class CommandPump : public Thread {
+public:
+  explicit CommandPump(UCIAdapter& adapter)
+    : adapter(adapter),
+      busy(false),
+      closed(false)
+  {}
+
+  //--------------------------------------------------------------------------
+  //! \brief Queue a command for execution
+  //! \return false if the pump has stopped executing commands
+  //--------------------------------------------------------------------------
+  bool push(const std::string& line) {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    if (closed) {
+      return false;
+    }
+    lines.push_back(line);
+    ready.notify_one();
+    return true;
+  }
+
+  //--------------------------------------------------------------------------
+  //! \brief Call \p action if no command is queued or executing
+  //! No command can start executing until \p action returns.
+  //! \return true if \p action was called
+  //--------------------------------------------------------------------------
+  template<typename Action>
+  bool ifIdle(Action action) {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    if (busy || lines.size()) {
+      return false;
+    }
+    action();
+    return true;
+  }
+
+  //--------------------------------------------------------------------------
+  //! \brief Exit once all queued commands have been executed
+  //--------------------------------------------------------------------------
+  void stop() {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    closed = true;
+    ready.notify_one();
+  }
+
+protected:
+  void doWork() {
+    while (true) {
+      std::string line;
+      {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        ready.wait(lock, [this]() { return (closed || lines.size()); });
+        if (lines.empty()) {
+          break;
+        }
+        line.swap(lines.front());
+        lines.pop_front();
+        busy = true;
+      }
+
+      // queued isready is answered in order, but without waiting for the
+      // current search to finish, which may be waiting for a ponderhit
+      TokenCursor args(line);
+      bool more = true;
+      if (args.skip(token::IsReady) && args.empty()) {
+        if (adapter.engine.isDebugOn()) {
+          Output() << "received command: " << line;
+        }
+        adapter.doReadyOk();
+      }
+      else {
+        more = adapter.doCommand(line);
+      }
+
+      std::lock_guard<std::mutex> lock(queueMutex);
+      busy = false;
+      if (!more) {
+        closed = true;
+        lines.clear();
+        break;
+      }
+    }
   }
-  else if (iEqual(token::Print, command)) {
-    doPrintCommand(params);
+
+private:
+  UCIAdapter& adapter;
+  std::mutex queueMutex;
+  std::condition_variable ready;
+  std::deque<std::string> lines;
+  bool busy;
+  bool closed;
+};
+
+//-----------------------------------------------------------------------------
+int UCIAdapter::run(const int fd) {
+  OutputSink::Scope scope(*sink);
+  CommandPump pump(*this);
+  pump.run();
+
+  std::string buffer;
+  char chunk[4096];
+  bool reading = true;
+  while (reading) {
+#ifdef WIN32
+    const int count = _read(fd, chunk, sizeof(chunk));
+#else
+    const ssize_t count = read(fd, chunk, sizeof(chunk));
+    if ((count < 0) && (errno == EINTR)) {
+      continue;
+    }
+#endif
+    if (count <= 0) {
+      break; // end of input
+    }
+
+    buffer.append(chunk, size_t(count));
+    size_t end = 0;
+    while (reading && ((end = buffer.find('\n')) != std::string::npos)) {
+      const std::string line = buffer.substr(0, end);
+      buffer.erase(0, (end + 1));
+      reading = pumpCommand(pump, line);
+    }
   }
-  else if (iEqual(token::Perft, command)) {
-    doStopCommand();
-    execute(std::unique_ptr<BackgroundCommand>(new PerftCommandHandle(engine)), params);
+
+  if (reading && buffer.size()) {
+    pumpCommand(pump, buffer);
   }
-  else if (iEqual(token::Test, command)) {
-    doStopCommand();
-    execute(std::unique_ptr<BackgroundCommand>(new TestCommandHandle(engine)), params);
+
+  pump.stop();
+  pump.waitForFinish();
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+//! \brief Handle one line of input read by run()
+//! \return false if no more input should be read
+//-----------------------------------------------------------------------------
+bool UCIAdapter::pumpCommand(CommandPump& pump, const std::string& input) {
+  const std::string line = trimRight(input, "\r");
+  TokenCursor args(line);
+  if (args.empty()) {
+    return true;
   }
-  else if (iEqual(token::Opts, command)) {
-    doOptsCommand(params);
+
+  const std::string_view command = args.next();
+  const bool quit = (iEqual(token::Quit, command) ||
+                     iEqual(token::Exit, command));
+
+  auto received = [this, &line]() {
+    if (engine.isDebugOn()) {
+      Output() << "received command: " << line;
+    }
+  };
+
+  if (iEqual(token::Stop, command) || quit) {
+    // stop immediately, then queue the command so it's also executed in
+    // order (e.g. after a "go" that hasn't started yet)
+    {
+      std::lock_guard<std::mutex> lock(commandMutex);
+      if (lastCommand) {
+        lastCommand->stop();
+      }
+    }
+    engine.stopSearching();
   }
-  else if (iEqual(token::Help, command)) {
-    doHelpCommand(params);
+  else if (iEqual(token::PonderHit, command) && args.empty()) {
+    if (pump.ifIdle([&]() { received(); engine.ponderHit(); })) {
+      return true;
+    }
   }
-  else if (iEqual(token::Exit, command) ||
-           iEqual(token::Quit, command))
+  else if (iEqual(token::IsReady, command) && args.empty() &&
+           engine.isInitialized())
   {
-    if (doQuitCommand(params)) {
-      return false;
+    auto readyOk = [&]() {
+      received();
+      Output(Output::NoPrefix) << "readyok";
+    };
+    if (pump.ifIdle(readyOk)) {
+      return true;
     }
   }
-  else if (isMove(command)) {
-    doStopCommand();
-    params.push_front(command);
-    doMoveCommand(params);
-  }
-  else {
-    Output() << "Unknown command: '" << command << "'";
-    Output() << "Enter 'help' for a list of commands";
-  }
-  return true;
+
+  return (pump.push(line) && !quit);
 }
 
 //-----------------------------------------------------------------------------
@@ -162,6 +470,7 @@ void UCIAdapter::doHelpCommand(Parameters& /*params*/) {
   Output() << "  " << token::Uci;
   Output() << "  " << token::UciNewGame;
   Output() << "Additional commands:";
+  Output() << "  " << token::Bench;
   Output() << "  " << token::Exit;
   Output() << "  " << token::Fen;
   Output() << "  " << token::Help;
@@ -169,6 +478,22 @@ void UCIAdapter::doHelpCommand(Parameters& /*params*/) {
   Output() << "  " << token::Perft;
   Output() << "  " << token::Print;
   Output() << "  " << token::Test;
+  Output() << "  " << token::Throttle;
+
+  std::vector<std::string> custom;
+  for (auto& entry : commands) {
+    if (entry.second.custom) {
+      custom.push_back(entry.first);
+    }
+  }
+  if (custom.size()) {
+    std::sort(custom.begin(), custom.end());
+    Output() << "Engine commands:";
+    for (auto& name : custom) {
+      Output() << "  " << name;
+    }
+  }
+
   Output() << "Also try '<command> help' for help on a specific command";
   Output() << "Or enter move(s) in coordinate notation, e.g. d2d4 g8f6";
 }
@@ -176,17 +501,17 @@ void UCIAdapter::doHelpCommand(Parameters& /*params*/) {
 //-----------------------------------------------------------------------------
 //! \brief Execute the given background command thread
 //-----------------------------------------------------------------------------
-void UCIAdapter::execute(std::unique_ptr<BackgroundCommand> command,
+bool UCIAdapter::execute(std::unique_ptr<BackgroundCommand> command,
                          Parameters& params)
 {
   if (!command) {
-    return;
+    return false;
   }
 
   if (params.firstParamIs(token::Help)) {
     Output() << "usage: " << command->usage();
     Output() << command->description();
-    return;
+    return true;
   }
 
   if (lastCommand) {
@@ -194,9 +519,14 @@ void UCIAdapter::execute(std::unique_ptr<BackgroundCommand> command,
     lastCommand->waitForFinish();
   }
 
-  if (command->parseAndExecute(params)) {
-    lastCommand.swap(command);
+  if (!command->parseAndExecute(params)) {
+    commandFailed = true;
+    return false;
   }
+
+  std::lock_guard<std::mutex> lock(commandMutex);
+  lastCommand.swap(command);
+  return true;
 }
 
 //-----------------------------------------------------------------------------
@@ -320,6 +650,49 @@ void UCIAdapter::doOptsCommand(Parameters& /*params*/) {
   }
 }
 
+//-----------------------------------------------------------------------------
+//! \brief Do the "throttle" command (not a UCI command)
+//! Set the info line interval and output info line counters
+//-----------------------------------------------------------------------------
+void UCIAdapter::doThrottleCommand(Parameters& params) {
+  if (params.firstParamIs(token::Help)) {
+    Output() << "usage: " << token::Throttle << " [interval <msecs>] [reset]";
+    Output() << "Output counts of info lines written and suppressed.";
+    Output() << "Set interval to coalesce currmove, currline, and status info";
+    Output() << "lines written within <msecs> of each other, 0 to disable.";
+    Output() << "Lines with a pv, score, or bound are never suppressed.";
+    return;
+  }
+
+  bool invalid = false;
+  bool reset = false;
+  uint64_t msecs = Output::getInfoInterval();
+  while (!invalid && params.size()) {
+    if (params.popNumber("interval", msecs, invalid) ||
+        params.popParam("reset", reset))
+    {
+      continue;
+    }
+    Output() << "Unexpected token: " << params.front();
+    return;
+  }
+
+  if (invalid) {
+    Output() << "usage: " << token::Throttle << " [interval <msecs>] [reset]";
+    return;
+  }
+
+  Output::setInfoInterval(msecs);
+  const InfoThrottle::Counters counters = Output::getInfoCounters(reset);
+  Output() << "interval " << msecs << " msecs";
+  for (int i = 0; i < InfoThrottle::KindCount; ++i) {
+    const InfoThrottle::Kind kind = static_cast<InfoThrottle::Kind>(i);
+    Output() << InfoThrottle::getKindName(kind) << ' '
+             << counters.written[i] << " written, "
+             << counters.suppressed[i] << " suppressed";
+  }
+}
+
 //-----------------------------------------------------------------------------
 //! \brief Execute the given move(s) on the current position
 //-----------------------------------------------------------------------------
@@ -367,6 +740,7 @@ bool UCIAdapter::doQuitCommand(Parameters& params) {
     lastCommand->waitForFinish();
   }
 
+  Output::flush();
   return true;
 }
 
@@ -404,8 +778,8 @@ void UCIAdapter::doDebugCommand(Parameters& params) {
 //!   is calculating in which case the engine should also immediately answer
 //!   with "readyok" without stopping the search.
 //-----------------------------------------------------------------------------
-void UCIAdapter::doIsReadyCommand(Parameters& params) {
-  if (params.firstParamIs(token::Help)) {
+void UCIAdapter::doIsReadyCommand(TokenCursor& args) {
+  if (args.nextIs(token::Help)) {
     Output() << "usage: " << token::IsReady;
     Output() << "Output readyok when engine is ready to receive input.";
     return;
@@ -420,6 +794,16 @@ void UCIAdapter::doIsReadyCommand(Parameters& params) {
     lastCommand->waitForFinish();
   }
 
+  doReadyOk();
+}
+
+//-----------------------------------------------------------------------------
+//! \brief Answer "isready" without waiting for the last command to finish
+//-----------------------------------------------------------------------------
+void UCIAdapter::doReadyOk() {
+  if (!engine.isInitialized()) {
+    engine.initialize();
+  }
   Output(Output::NoPrefix) << "readyok";
 }
 
@@ -429,14 +813,17 @@ void UCIAdapter::doIsReadyCommand(Parameters& params) {
 //!   Stop calculating as soon as possible, don't forget the "bestmove" and
 //!   possibly the "ponder" token when finishing the search.
 //-----------------------------------------------------------------------------
-void UCIAdapter::doStopCommand(Parameters params) {
-  if (params.firstParamIs(token::Help)) {
+void UCIAdapter::doStopCommand(TokenCursor args) {
+  if (args.nextIs(token::Help)) {
     Output() << "usage: " << token::Stop;
     Output() << "Stop engine if it is calculating.";
     return;
   }
 
   engine.stopSearching();
+  if (lastCommand) {
+    lastCommand->stop();
+  }
 }
 
 //-----------------------------------------------------------------------------
@@ -555,10 +942,10 @@ void UCIAdapter::doUCINewGameCommand(Parameters params) {
 //!   different game than the last position sent to the engine, the GUI should
 //!   have sent a "ucinewgame" inbetween.
 //-----------------------------------------------------------------------------
-void UCIAdapter::doPositionCommand(const std::string& fenstring,
-                                   Parameters& params)
+void UCIAdapter::doPositionCommand(const std::string_view line,
+                                   TokenCursor& args)
 {
-  if (params.empty() || params.firstParamIs(token::Help)) {
+  if (args.empty() || args.nextIs(token::Help)) {
     Output() << "usage: " << token::Position << " {" << token::StartPos << "|"
              << token::Fen << " <fen_string>} [<movelist>]";
     Output() << "Set a new position and apply <movelist> (if given).";
@@ -575,38 +962,41 @@ void UCIAdapter::doPositionCommand(const std::string& fenstring,
     lastCommand->waitForFinish();
   }
 
-  if (lastPosition.size() &&
-      lastPosition == fenstring.substr(0, lastPosition.size()))
+  const size_t len = lastPosition.size();
+  std::string remain;
+  if (len && (line.substr(0, len) == lastPosition) &&
+      ((line.size() == len) ||
+       std::isspace(static_cast<unsigned char>(line[len]))))
   {
     // continue from current position
-    params.parse(fenstring.substr(lastPosition.size() + 1));
+    args = TokenCursor(line.substr(len));
   }
   else {
-    if (params.firstParamIs(token::StartPos)) {
+    lastPosition.clear();
+    if (args.skip(token::StartPos)) {
       if (!engine.setPosition(ChessEngine::STARTPOS)) {
         return;
       }
     }
     else {
       // consume "fen" token if present
-      params.popParam(token::Fen);
-      std::string remain;
-      if (!engine.setPosition(params.toString(), &remain)) {
+      args.skip(token::Fen);
+      if (!engine.setPosition(std::string(args.rest()), &remain)) {
         return;
       }
-      params.parse(remain);
+      args = TokenCursor(remain);
     }
   }
 
   // remember this position command for next time
-  lastPosition = fenstring;
+  lastPosition.assign(line.data(), line.size());
 
   // consume "moves" token if present
-  params.popParam(token::Moves);
+  args.skip(token::Moves);
 
   // apply moves (if any)
-  while (params.size() && isMove(params.front())) {
-    std::string move = params.popString();
+  while (!args.empty() && isMove(args.peek())) {
+    const std::string move(args.next());
     if (!engine.makeMove(move)) {
       Output() << "Invalid move: " << move;
       lastPosition.clear();
@@ -684,7 +1074,7 @@ void UCIAdapter::doSetOptionCommand(Parameters& params) {
 //!   was told to ponder on the same move the user has played. The engine
 //!   should continue searching but switch from pondering to normal search.
 //-----------------------------------------------------------------------------
-void UCIAdapter::doPonderHitCommand(Parameters& /*params*/) {
+void UCIAdapter::doPonderHitCommand(TokenCursor& /*args*/) {
   engine.ponderHit();
 }
 
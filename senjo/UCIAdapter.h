@@ -26,24 +26,127 @@
 #include "ChessEngine.h"
 #include "Parameters.h"
 #include "BackgroundCommand.h"
+#include "OutputSink.h"
+#include <functional>
+#include <unordered_map>
 
 namespace senjo {
 
+class CommandPump;
+
 //-----------------------------------------------------------------------------
 //! \brief Convenience class to handle UCI communication for a ChessEngine
 //-----------------------------------------------------------------------------
 class UCIAdapter {
 public:
-  UCIAdapter(ChessEngine& engine);
+  //--------------------------------------------------------------------------
+  //! \brief Flags that control how a registered command is executed
+  //--------------------------------------------------------------------------
+  enum CommandFlags {
+    NoFlags     = 0x00, ///< Call the handler as is
+    StopsSearch = 0x01, ///< Stop the current search first
+    NeedsInit   = 0x02, ///< Initialize the engine first, if necessary
+    Background  = 0x04  ///< Call the handler on a background thread
+  };
+
+  //--------------------------------------------------------------------------
+  //! \brief Handler for a registered command
+  //! Called with the parameters that follow the command name.
+  //--------------------------------------------------------------------------
+  typedef CustomCommandHandle::Handler CommandHandler;
+
+  //--------------------------------------------------------------------------
+  //! \brief Constructor
+  //! \param[in] engine The engine to control
+  //! \param[in] sink Where all output from this adapter, its commands, and
+  //!                 the engine (on threads started by senjo) goes, stdout
+  //!                 if null
+  //--------------------------------------------------------------------------
+  explicit UCIAdapter(ChessEngine& engine,
+                      std::shared_ptr<OutputSink> sink = nullptr);
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the sink this adapter's output goes to
+  //! \return Reference to this adapter's output sink
+  //--------------------------------------------------------------------------
+  OutputSink& getOutputSink() { return *sink; }
 
   //--------------------------------------------------------------------------
   //! \brief Execute the given one-line command
-  //! \param[in] cmd The command to execute
+  //! The line is tokenized in place.  "position", "stop", "isready", and
+  //! "ponderhit" are parsed without allocating memory.
+  //! \param[in] line The command to execute
   //! \return false when the program should exit, true to continue processing
   //--------------------------------------------------------------------------
-  bool doCommand(const std::string& command);
+  bool doCommand(const std::string_view line);
+
+  //--------------------------------------------------------------------------
+  //! \brief Execute a single command given on the program's command line
+  //! The command line arguments are joined into one command, which is
+  //! executed to completion before returning.  Useful for running commands
+  //! such as "bench" from scripts, e.g. "myengine bench depth 10".
+  //! \param[in] argc Number of arguments, including the program name
+  //! \param[in] argv The arguments, argv[0] is the program name
+  //! \return Exit status for the program, 0 if the command succeeded, 1 if
+  //!         it is unknown, its parameters are invalid, or it failed
+  //--------------------------------------------------------------------------
+  int runCommandLine(const int argc, const char* const argv[]);
+
+  //--------------------------------------------------------------------------
+  //! \brief Read and execute commands from a file descriptor until quit
+  //! Input is read on the calling thread while commands are executed, in
+  //! order, on a separate thread.  So "stop" (and "quit") take effect
+  //! immediately even while a command such as "position" or "go" is waiting
+  //! for the previous search to finish.  "ponderhit" and "isready" are also
+  //! handled as soon as they are read when no other command is queued or
+  //! executing, and "isready" never waits for a search to finish.
+  //! Returns when "quit" is received or at end of input, after executing
+  //! everything that was read.
+  //! \param[in] fd The file descriptor to read, stdin by default
+  //! \return Exit status for the program
+  //--------------------------------------------------------------------------
+  int run(const int fd = 0);
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the time from "stop" to "bestmove" of every stopped search
+  //! \return Copy of the recorded times, in microseconds
+  //--------------------------------------------------------------------------
+  Histogram getStopLatency() { return stopLatency.get(); }
+
+  //--------------------------------------------------------------------------
+  //! \brief Add an engine specific command, e.g. "eval" or "tune"
+  //! Command names are not case sensitive.  Registering a name that already
+  //! exists, including one of the built-in commands, replaces it.
+  //! A Background command runs the same way "go" and "perft" do: any running
+  //! command is stopped first, "stop" calls ChessEngine::stopSearching(), and
+  //! "<name> help" outputs generic usage rather than calling the handler.
+  //! Not thread safe, register all commands before executing any.
+  //! \param[in] name The command name
+  //! \param[in] handler Function to call when the command is received
+  //! \param[in] flags Bitwise OR of CommandFlags values
+  //--------------------------------------------------------------------------
+  void registerCommand(const std::string& name, const CommandHandler& handler,
+                       const int flags = NoFlags);
 
 private:
+  friend class CommandPump;
+
+  typedef std::function<bool(const std::string_view line, TokenCursor& args)>
+      Dispatch;
+  typedef std::function<bool(Parameters& params)> ParamsDispatch;
+
+  struct Command {
+    Dispatch dispatch;
+    int flags;
+    bool custom;
+  };
+
+  void addCommand(const std::string& name, const int flags,
+                  const Dispatch& dispatch, const bool custom = false);
+  void addCommand(const std::string& name, const int flags,
+                  const ParamsDispatch& dispatch, const bool custom = false);
+  bool pumpCommand(CommandPump& pump, const std::string& line);
+  void doReadyOk();
   void doHelpCommand(Parameters& params);
   void doFENCommand(Parameters& params);
   void doMoveCommand(Parameters& params);
@@ -52,17 +155,23 @@ private:
   void doPrintCommand(Parameters& params);
   bool doQuitCommand(Parameters& params);
   void doDebugCommand(Parameters& params);
-  void doIsReadyCommand(Parameters& params);
-  void doPonderHitCommand(Parameters& params);
+  void doIsReadyCommand(TokenCursor& args);
+  void doPonderHitCommand(TokenCursor& args);
   void doSetOptionCommand(Parameters& params);
-  void doStopCommand(Parameters params = {});
+  void doStopCommand(TokenCursor args = TokenCursor());
+  void doThrottleCommand(Parameters& params);
   void doUCICommand(Parameters& params);
   void doUCINewGameCommand(Parameters params = {});
-  void doPositionCommand(const std::string& line, Parameters& params);
-  void execute(std::unique_ptr<BackgroundCommand> command, Parameters& params);
+  void doPositionCommand(const std::string_view line, TokenCursor& args);
+  bool execute(std::unique_ptr<BackgroundCommand> command, Parameters& params);
 
   ChessEngine& engine;
+  std::shared_ptr<OutputSink> sink;
   std::string lastPosition;
+  std::unordered_map<std::string, Command> commands; // keyed by lower case name
+  StopLatency stopLatency;
+  bool commandFailed = false; // last doCommand() was unknown or invalid
+  std::mutex commandMutex; // guards changes to lastCommand for run()
   std::unique_ptr<BackgroundCommand> lastCommand;
 };
 
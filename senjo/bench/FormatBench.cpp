@@ -0,0 +1,251 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2019 Shawn Chidester <zd3nik@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//-----------------------------------------------------------------------------
+
+
+//-----------------------------------------------------------------------------
+// Compare the cost of building and writing a typical search "info" line
+// with Output's std::ostream insertion operators, LineFormatter with
+// Output::write(), and InfoLine.  stdout is redirected to /dev/null, so the
+// synchronous and asynchronous cases pay for the same kind of write calls
+// and differ only in which thread makes them.  Times are measured on the
+// calling threads, queued lines are flushed after each case.  InfoThrottle
+// ordering is checked first and a failure exits with status 1.
+//
+// usage: format_bench [lines per thread (default 1000000)] [threads (default 1)]
+//-----------------------------------------------------------------------------
+
+#include "InfoLine.h"
+#include "InfoThrottle.h"
+#include "LineFormatter.h"
+#include "Output.h"
+#include "SearchStats.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <thread>
+#include <vector>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace senjo;
+
+//-----------------------------------------------------------------------------
+// count every heap allocation made by the program
+//-----------------------------------------------------------------------------
+static std::atomic<uint64_t> _allocations(0);
+static FILE* _results = stdout;
+
+void* operator new(size_t size) {
+  _allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* ptr = malloc(size ? size : 1)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  free(ptr);
+}
+
+//-----------------------------------------------------------------------------
+static const int PV_LENGTH = 12;
+
+struct Line {
+  SearchStats stats;
+  int score;
+  ChessMove pv[PV_LENGTH];
+};
+
+//-----------------------------------------------------------------------------
+static void makeLine(Line& line, const uint64_t i) {
+  line.stats.depth = int(10 + (i % 20));
+  line.stats.seldepth = int(20 + (i % 30));
+  line.stats.nodes = (123456789 + (i * 7919));
+  line.stats.msecs = (1000 + (i % 60000));
+  line.score = int(i % 600) - 300;
+  for (int n = 0; n < PV_LENGTH; ++n) {
+    line.pv[n].from = Square(int((i + n) % 8), int(n % 8));
+    line.pv[n].to = Square(int((i + n + 3) % 8), int((n + 2) % 8));
+  }
+}
+
+//-----------------------------------------------------------------------------
+static void streamLine(const Line& line) {
+  Output out(Output::NoPrefix);
+  out << "info " << line.stats << " score cp " << line.score << " pv";
+  for (int n = 0; n < PV_LENGTH; ++n) {
+    out << ' ' << line.pv[n].toString();
+  }
+}
+
+//-----------------------------------------------------------------------------
+static void formatLine(const Line& line) {
+  LineFormatter out;
+  out << "info " << line.stats << " score cp " << line.score << " pv";
+  for (int n = 0; n < PV_LENGTH; ++n) {
+    out << ' ' << line.pv[n];
+  }
+  Output::write(out.view(), Output::NoPrefix);
+}
+
+//-----------------------------------------------------------------------------
+static void infoLine(const Line& line) {
+  InfoLine info;
+  info.setStats(line.stats).setScore(line.score);
+  for (int n = 0; n < PV_LENGTH; ++n) {
+    info.addPv(line.pv[n]);
+  }
+  Output::write(info);
+}
+
+//-----------------------------------------------------------------------------
+//! \brief Feed \p lines through an InfoThrottle with a long interval
+//! \return true if the throttle writes \p expected in total
+//-----------------------------------------------------------------------------
+static bool checkThrottle(const char* name,
+                          const std::vector<std::string>& lines,
+                          const std::string& expected)
+{
+  InfoThrottle throttle;
+  throttle.setInterval(60000);
+  std::string written;
+  for (const std::string& line : lines) {
+    std::string text(line);
+    throttle.filter(text);
+    written += text;
+  }
+  const bool ok = (written == expected);
+  fprintf(_results, "%-40s %s\n", name, (ok ? "ok" : "FAILED"));
+  return ok;
+}
+
+//-----------------------------------------------------------------------------
+static void run(const char* name, void (*writeLine)(const Line&),
+                const uint64_t count, const int threads)
+{
+  // warm up thread local buffers before counting
+  Line line;
+  makeLine(line, 0);
+  writeLine(line);
+
+  const uint64_t allocations = _allocations;
+  const TimePoint start = now();
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([writeLine, count, t]() {
+      Line line;
+      for (uint64_t i = 0; i < count; ++i) {
+        makeLine(line, (i + uint64_t(t)));
+        writeLine(line);
+      }
+    });
+  }
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  const uint64_t usecs = getUsecs(start);
+  Output::flush();
+
+  const double total = double(count) * threads;
+  fprintf(_results, "%-18s %10.1f ns/line %10.0f lines/sec %8.2f allocs/line\n",
+         name, (1000.0 * double(usecs) / total),
+         (usecs ? (total * 1000000.0 / double(usecs)) : 0.0),
+         (double(_allocations - allocations - threads) / total));
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[]) {
+  const uint64_t count = (argc > 1) ? toNumber<uint64_t>(argv[1]) : 1000000;
+  const int threads = (argc > 2) ? toNumber<int>(argv[2]) : 1;
+  if (!count || (threads < 1)) {
+    fprintf(stderr, "usage: %s [lines per thread] [threads]\n", argv[0]);
+    return 1;
+  }
+
+#ifndef WIN32
+  // results go to the original stdout, everything else to /dev/null
+  fflush(stdout);
+  const int saved = dup(STDOUT_FILENO);
+  const int devNull = open("/dev/null", O_WRONLY);
+  if ((saved >= 0) && (devNull >= 0)) {
+    _results = fdopen(saved, "w");
+    dup2(devNull, STDOUT_FILENO);
+    close(devNull);
+  }
+#endif
+
+  // the final status line goes out ahead of bestmove, stale currmove doesn't
+  bool ok = checkThrottle("throttle status before bestmove", {
+      "info depth 1 nodes 20 nps 2000 time 10\n",
+      "info currmove e2e4 currmovenumber 1\n",
+      "info depth 2 nodes 80 nps 4000 time 20\n",
+      "info currmove d2d4 currmovenumber 2\n",
+      "bestmove e2e4\n"
+    },
+    "info depth 1 nodes 20 nps 2000 time 10\n"
+    "info currmove e2e4 currmovenumber 1\n"
+    "info depth 2 nodes 80 nps 4000 time 20\n"
+    "bestmove e2e4\n");
+  ok &= checkThrottle("throttle status superseded by pv", {
+      "info nodes 20 nps 2000 time 10\n",
+      "info nodes 80 nps 4000 time 20\n",
+      "info depth 2 score cp 5 pv e2e4\n",
+      "bestmove e2e4\n"
+    },
+    "info nodes 20 nps 2000 time 10\n"
+    "info depth 2 score cp 5 pv e2e4\n"
+    "bestmove e2e4\n");
+  if (!ok) {
+    return 1;
+  }
+
+  std::vector<std::pair<const char*, void (*)(const Line&)>> cases = {
+    { "Output <<", streamLine },
+    { "LineFormatter", formatLine },
+    { "InfoLine", infoLine }
+  };
+
+  fprintf(_results, "%llu lines per thread, %d thread(s)\n",
+         static_cast<unsigned long long>(count), threads);
+  for (auto& test : cases) {
+    run(test.first, test.second, count, threads);
+  }
+
+  Output::setAsync(true);
+  for (auto& test : cases) {
+    std::string name = std::string(test.first) + " async";
+    run(name.c_str(), test.second, count, threads);
+  }
+  Output::setAsync(false);
+
+  fflush(_results);
+  return 0;
+}
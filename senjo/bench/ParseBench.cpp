@@ -0,0 +1,284 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2019 Shawn Chidester <zd3nik@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Compare the cost of parsing UCI command lines the way Parameters used to
+// (std::stringstream into a std::list<std::string>), with Parameters as it
+// is now, with TokenCursor, and through UCIAdapter::doCommand() with an
+// engine that does nothing.  The "position" line is 300 plies deep.
+// Before measuring, check that "go" still accepts the clock values GUIs
+// send in practice, such as a negative wtime after lag.
+//
+// usage: parse_bench [lines (default 100000)]
+//-----------------------------------------------------------------------------
+
+#include "ChessEngine.h"
+#include "OutputSink.h"
+#include "Parameters.h"
+#include "TokenCursor.h"
+#include "UCIAdapter.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+#include <vector>
+
+using namespace senjo;
+
+//-----------------------------------------------------------------------------
+// count every heap allocation made by the program
+//-----------------------------------------------------------------------------
+static std::atomic<uint64_t> _allocations(0);
+
+void* operator new(size_t size) {
+  _allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* ptr = malloc(size ? size : 1)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  free(ptr);
+}
+
+//-----------------------------------------------------------------------------
+// accepts everything, so only the adapter's parsing is measured
+//-----------------------------------------------------------------------------
+class NullEngine : public ChessEngine {
+public:
+  std::string getEngineName() const { return "null"; }
+  std::string getEngineVersion() const { return "0"; }
+  std::string getAuthorName() const { return "none"; }
+  std::list<EngineOption> getOptions() const { return {}; }
+  bool setEngineOption(const std::string&, const std::string&) {
+    return false;
+  }
+  void initialize() { }
+  bool isInitialized() const { return true; }
+  bool setPosition(const std::string&, std::string* = nullptr) {
+    return true;
+  }
+  bool makeMove(const std::string& move) {
+    moves += move.size();
+    return true;
+  }
+  std::string getFEN() const { return ChessEngine::STARTPOS; }
+  void printBoard() const { }
+  bool whiteToMove() const { return true; }
+  void clearSearchData() { }
+  void ponderHit() { }
+  void setDebug(const bool) { }
+  bool isDebugOn() const { return false; }
+  bool isSearching() { return false; }
+  void stopSearching() { }
+  bool stopRequested() const { return false; }
+  void waitForSearchFinish() { }
+  uint64_t perft(const int) { return 0; }
+  std::string go(const GoParams& params, std::string* = nullptr) {
+    lastGo = params;
+    return "";
+  }
+  SearchStats getSearchStats() const { return SearchStats(); }
+
+  uint64_t moves = 0;
+  GoParams lastGo;
+};
+
+//-----------------------------------------------------------------------------
+static const int PLIES = 300;
+
+static std::string _position[2];
+static std::string _go;
+static NullEngine _engine;
+static UCIAdapter* _adapter = nullptr;
+static uint64_t _sum = 0;
+
+//-----------------------------------------------------------------------------
+static void makeLines() {
+  static const char* cycle[] = { "g1f3", "g8f6", "f3g1", "f6g8" };
+  for (int i = 0; i < 2; ++i) {
+    // the first move differs so doCommand() can't continue from the
+    // previous position and must parse the whole line every time
+    _position[i] = (i ? "position startpos moves b1c3"
+                      : "position startpos moves b1a3");
+    for (int ply = 1; ply < PLIES; ++ply) {
+      _position[i] += ' ';
+      _position[i] += cycle[ply % 4];
+    }
+  }
+  _go = "go wtime 300000 btime 298750 winc 2000 binc 2000 movestogo 40";
+}
+
+//-----------------------------------------------------------------------------
+// how Parameters parsed lines and numbers before TokenCursor
+//-----------------------------------------------------------------------------
+static std::list<std::string> streamParse(const std::string& line) {
+  std::list<std::string> params;
+  std::stringstream ss(line);
+  std::string param;
+  while (ss >> param) {
+    params.push_back(param);
+  }
+  return params;
+}
+
+static void streamPosition(const uint64_t i) {
+  std::list<std::string> params = streamParse(_position[i & 1]);
+  while (params.size()) {
+    std::string move = params.front();
+    params.pop_front();
+    _sum += move.size();
+  }
+}
+
+static void streamGo(const uint64_t /*i*/) {
+  std::list<std::string> params = streamParse(_go);
+  params.pop_front();
+  while (params.size() > 1) {
+    params.pop_front();
+    std::stringstream ss(params.front());
+    uint64_t value = 0;
+    if (ss >> value) {
+      _sum += value;
+    }
+    params.pop_front();
+  }
+}
+
+//-----------------------------------------------------------------------------
+static void paramsPosition(const uint64_t i) {
+  Parameters params(_position[i & 1]);
+  while (params.size()) {
+    _sum += params.popString().size();
+  }
+}
+
+static void paramsGo(const uint64_t /*i*/) {
+  Parameters params(_go);
+  params.pop_front();
+  while (params.size() > 1) {
+    params.pop_front();
+    _sum += params.popNumber<uint64_t>();
+  }
+}
+
+//-----------------------------------------------------------------------------
+static void cursorPosition(const uint64_t i) {
+  TokenCursor tokens(_position[i & 1]);
+  while (!tokens.empty()) {
+    const std::string move(tokens.next());
+    _sum += move.size();
+  }
+}
+
+static void cursorGo(const uint64_t /*i*/) {
+  TokenCursor tokens(_go);
+  tokens.next();
+  while (!tokens.empty()) {
+    tokens.next();
+    uint64_t value = 0;
+    tokens.nextNumber(value);
+    _sum += value;
+  }
+}
+
+//-----------------------------------------------------------------------------
+static void adapterPosition(const uint64_t i) {
+  _adapter->doCommand(_position[i & 1]);
+}
+
+//-----------------------------------------------------------------------------
+static bool checkGo(const std::string& line, const uint64_t wtime,
+                    const uint64_t btime, const uint64_t movetime)
+{
+  NullEngine engine;
+  engine.lastGo.wtime = 12345;
+  UCIAdapter adapter(engine, std::make_shared<CallbackSink>(
+      [](const std::string_view) { }));
+  adapter.doCommand(line);
+  adapter.doCommand("isready"); // wait for the search to finish
+
+  const GoParams& params = engine.lastGo;
+  const bool ok = ((params.wtime == wtime) && (params.btime == btime) &&
+                   (params.movetime == movetime));
+  printf("%-40s %s\n", line.c_str(), (ok ? "ok" : "FAILED"));
+  return ok;
+}
+
+//-----------------------------------------------------------------------------
+static void run(const char* name, void (*parseLine)(const uint64_t),
+                const uint64_t count)
+{
+  parseLine(0); // warm up
+  parseLine(1);
+
+  const uint64_t allocations = _allocations;
+  const TimePoint start = now();
+  for (uint64_t i = 0; i < count; ++i) {
+    parseLine(i);
+  }
+  const uint64_t usecs = getUsecs(start);
+
+  const double total = double(count);
+  printf("%-20s %10.1f ns/line %8.2f allocs/line\n", name,
+         (1000.0 * double(usecs) / total),
+         (double(_allocations - allocations) / total));
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[]) {
+  const uint64_t count = (argc > 1) ? toNumber<uint64_t>(argv[1]) : 100000;
+  if (!count) {
+    fprintf(stderr, "usage: %s [lines]\n", argv[0]);
+    return 1;
+  }
+
+  bool ok = checkGo("go wtime -500 btime 1000", 0, 1000, 0);
+  ok &= checkGo("go wtime +2000 btime 0 winc 0 binc 0", 2000, 0, 0);
+  ok &= checkGo("go movetime 1000.5", 0, 0, 1000);
+  if (!ok) {
+    return 1;
+  }
+
+  makeLines();
+  UCIAdapter adapter(_engine);
+  _adapter = &adapter;
+
+  printf("%llu lines, position is %d plies\n",
+         static_cast<unsigned long long>(count), PLIES);
+  run("position stream", streamPosition, count);
+  run("position Parameters", paramsPosition, count);
+  run("position TokenCursor", cursorPosition, count);
+  run("position doCommand", adapterPosition, count);
+  run("go stream", streamGo, count);
+  run("go Parameters", paramsGo, count);
+  run("go TokenCursor", cursorGo, count);
+
+  // keep the results alive so the work isn't optimized away
+  return ((_sum + _engine.moves) == 1) ? 1 : 0;
+}